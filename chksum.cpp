@@ -0,0 +1,1631 @@
+//------------------------------------------------------------------------------
+//						sim_logger
+//  chksum.cpp - IGC checksum, FileReader and batch verify
+//
+//  Description:
+//              checksums files and IGC tracklogs, and checks batches of IGC files
+//              for 'sim_logger verify'. Needs no FSX or SimConnect, so it builds
+//              into sim_logger.exe on Windows and sim_logger_verify on Linux.
+//
+//              Written by Ian Forster-Lewis www.forsterlewis.com
+//------------------------------------------------------------------------------
+
+#include "chksum.h"
+#ifdef _WIN32
+#include <intrin.h>    // __cpuid
+#include <process.h>   // _beginthreadex
+#else
+#include <cpuid.h>     // __cpuid_count
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>    // PATH_MAX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+#include <tmmintrin.h> // SSSE3 intrinsics
+#include <immintrin.h> // AVX-512 VBMI intrinsics
+
+// MSVC compiles intrinsics whatever the target CPU, g++ only in functions marked
+// for it (chksum_init() only picks the engines the CPU has)
+#ifdef _MSC_VER
+#define TARGET_SSSE3
+#define TARGET_VBMI
+#else
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_VBMI __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+#endif
+
+//********************************************************************************
+//********************   PLATFORM                 ********************************
+//********************************************************************************
+// Win32 and POSIX versions of the timer, threads, CPUID and folder listing
+
+#ifdef _WIN32
+
+double perf_seconds() {
+    LARGE_INTEGER count, freq;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+}
+
+bool thread_start(Thread *thread, ThreadProc func, void *arg) {
+	*thread = (HANDLE)_beginthreadex(NULL, 0, func, arg, 0, NULL);
+	return *thread!=0;
+}
+
+void thread_wait(Thread thread) {
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+long thread_increment(volatile long *value) {
+	return InterlockedIncrement(value);
+}
+
+// CPUID leaf/subleaf into info[] (EAX, EBX, ECX, EDX)
+void cpu_id(int info[4], int leaf, int subleaf) {
+	__cpuidex(info, leaf, subleaf);
+}
+
+// XCR0, the register states the OS saves (only if CPUID says OSXSAVE)
+UINT64 cpu_xcr0() {
+	return _xgetbv(0);
+}
+
+int cpu_count() {
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+	return sys_info.dwNumberOfProcessors;
+}
+
+bool path_is_dir(const char *path) {
+	DWORD attributes = GetFileAttributesA(path);
+	return attributes!=INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+struct PathList {
+	HANDLE find;
+	WIN32_FIND_DATAA next_file;
+	bool first; // next_file is the first file, not returned yet
+};
+
+PathList *path_list(const char *dir) {
+	char pattern[MAXBUF];
+	if (!path_join(pattern, dir, "*")) return NULL;
+	PathList *list = (PathList *)malloc(sizeof(PathList));
+	if (list==NULL) return NULL;
+	list->find = FindFirstFileA(pattern, &list->next_file);
+	if (list->find==INVALID_HANDLE_VALUE) {
+		free(list);
+		return NULL;
+	}
+	list->first = true;
+	return list;
+}
+
+bool path_next(PathList *list, const char **name, bool *is_dir) {
+	if (!list->first && !FindNextFileA(list->find, &list->next_file)) return false;
+	list->first = false;
+	*name = list->next_file.cFileName;
+	*is_dir = (list->next_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)!=0;
+	return true;
+}
+
+void path_list_close(PathList *list) {
+	FindClose(list->find);
+	free(list);
+}
+
+void path_full(char *full, const char *path) {
+	if (_fullpath(full, path, MAXBUF)==NULL) strcpy_s(full, MAXBUF, path);
+}
+
+int path_compare(const char *a, const char *b) {
+	return _stricmp(a, b);
+}
+
+#else
+
+double perf_seconds() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+bool thread_start(Thread *thread, ThreadProc func, void *arg) {
+	return pthread_create(thread, NULL, func, arg)==0;
+}
+
+void thread_wait(Thread thread) {
+	pthread_join(thread, NULL);
+}
+
+long thread_increment(volatile long *value) {
+	return __sync_add_and_fetch(value, 1);
+}
+
+void cpu_id(int info[4], int leaf, int subleaf) {
+	unsigned int a, b, c, d;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	info[0] = a;
+	info[1] = b;
+	info[2] = c;
+	info[3] = d;
+}
+
+UINT64 cpu_xcr0() {
+	UINT32 lo, hi;
+	__asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((UINT64)hi << 32) | lo;
+}
+
+int cpu_count() {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n<1) ? 1 : (int)n;
+}
+
+bool path_is_dir(const char *path) {
+	struct stat st;
+	return stat(path, &st)==0 && S_ISDIR(st.st_mode);
+}
+
+struct PathList {
+	DIR *dir;
+	char dir_name[MAXBUF]; // as given to path_list()
+	char path[MAXBUF];     // dir_name + name, for stat()
+};
+
+PathList *path_list(const char *dir) {
+	PathList *list = (PathList *)malloc(sizeof(PathList));
+	if (list==NULL) return NULL;
+	list->dir = opendir(dir[0]=='\0' ? "." : dir);
+	if (list->dir==NULL) {
+		free(list);
+		return NULL;
+	}
+	strcpy_s(list->dir_name, MAXBUF, dir);
+	return list;
+}
+
+bool path_next(PathList *list, const char **name, bool *is_dir) {
+	struct dirent *entry = readdir(list->dir);
+	if (entry==NULL) return false;
+	*name = entry->d_name;
+	// (symbolic links are followed, as FindFirstFile() does)
+	if (entry->d_type!=DT_UNKNOWN && entry->d_type!=DT_LNK) *is_dir = entry->d_type==DT_DIR;
+	else *is_dir = path_join(list->path, list->dir_name, entry->d_name) && path_is_dir(list->path);
+	return true;
+}
+
+void path_list_close(PathList *list) {
+	closedir(list->dir);
+	free(list);
+}
+
+void path_full(char *full, const char *path) {
+	char buf[PATH_MAX];
+	if (realpath(path, buf)==NULL || !path_join(full, buf, "")) strcpy_s(full, MAXBUF, path);
+}
+
+int path_compare(const char *a, const char *b) {
+	return strcmp(a, b);
+}
+
+#endif
+
+bool path_join(char *path, const char *a, const char *b, const char *c) {
+	size_t na = strlen(a), nb = strlen(b), nc = strlen(c);
+	if (na+nb+nc>=(size_t)MAXBUF) return false;
+	memcpy(path, a, na);
+	memcpy(path+na, b, nb);
+	memcpy(path+na+nb, c, nc+1);
+	return true;
+}
+
+//*******************************************************************************
+//****************************  FILE READER  ************************************
+//*******************************************************************************
+// All the checksum and IGC reading code reads files through a FileReader. The file
+// is memory-mapped whole if it can be (up to FILE_MAP_MAX, to leave room in the
+// 32-bit address space), otherwise it is read in blocks of up to FILE_STREAM_BLOCK
+// into a page-aligned buffer. Either way:
+//   file_read_block() returns the next block of the file (the whole file when mapped)
+//   file_read_line()  returns the next line as fgets() in text mode would
+//                     ("\r\n" becomes "\n", lines longer than max-1 chars are split)
+//   file_next_line()  points to the next line in place, without copying it
+// file_open() returns false if the file can't be opened.
+
+const INT64 FILE_MAP_MAX = 256*1024*1024;      // bigger files are streamed
+const size_t FILE_STREAM_BLOCK = 64*1024*1024; // streaming read size (less for smaller files)
+const size_t FILE_STREAM_MIN = 64*1024;        // smallest streaming buffer
+
+// set up r for a file of 'length' bytes, before it's mapped or given a buffer
+void file_reset(FileReader *r, INT64 length) {
+	r->mapped = false;
+	r->data = NULL;
+	r->size = 0;
+	r->pos = 0;
+	r->buf_size = 0;
+	r->length = length;
+	r->offset = 0;
+	r->done = false;
+	r->reads = 0;
+}
+
+// streaming buffer size: one read for files up to FILE_STREAM_BLOCK
+size_t file_buf_size(FileReader *r) {
+	return (size_t)min(max(r->length, (INT64)FILE_STREAM_MIN), (INT64)FILE_STREAM_BLOCK);
+}
+
+#ifdef _WIN32
+
+// set up r to read the open file handle h (mapped if map is true and it can be)
+bool file_open_handle(FileReader *r, HANDLE h, bool map) {
+	LARGE_INTEGER length;
+	if (h==INVALID_HANDLE_VALUE) return false;
+	r->file = h;
+	r->mapping = NULL;
+	file_reset(r, GetFileSizeEx(h, &length) ? length.QuadPart : 0);
+	// (an empty file can't be mapped, and has nothing to stream either)
+	if (map && r->length>0 && r->length<=FILE_MAP_MAX) {
+		r->mapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (r->mapping!=NULL) {
+			r->data = (char *)MapViewOfFile(r->mapping, FILE_MAP_READ, 0, 0, 0);
+			r->mapped = r->data!=NULL;
+			if (r->mapped) return true;
+			CloseHandle(r->mapping);
+			r->mapping = NULL;
+		}
+	}
+	r->buf_size = file_buf_size(r);
+	r->data = (char *)VirtualAlloc(NULL, r->buf_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (r->data==NULL) {
+		CloseHandle(h);
+		return false;
+	}
+	return true;
+}
+
+bool file_open(FileReader *r, char *filepath, bool map) {
+	HANDLE h = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+						   OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	return file_open_handle(r, h, map);
+}
+
+bool file_open(FileReader *r, wchar_t *filepath, bool map) {
+	HANDLE h = CreateFileW(filepath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+						   OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	return file_open_handle(r, h, map);
+}
+
+void file_close(FileReader *r) {
+	if (r->mapped) {
+		UnmapViewOfFile(r->data);
+		CloseHandle(r->mapping);
+	}
+	else if (r->data!=NULL) VirtualFree(r->data, 0, MEM_RELEASE);
+	CloseHandle(r->file);
+	r->data = NULL;
+}
+
+// read the next buf_size bytes (or less) of the file into r->data, 0 at the end
+size_t file_read(FileReader *r) {
+	DWORD n = 0;
+	if (!ReadFile(r->file, r->data, (DWORD)r->buf_size, &n, NULL)) return 0;
+	return n;
+}
+
+#else
+
+bool file_open(FileReader *r, char *filepath, bool map) {
+	struct stat st;
+	int fd = open(filepath, O_RDONLY);
+	if (fd<0) return false;
+	r->file = fd;
+	file_reset(r, fstat(fd, &st)==0 ? (INT64)st.st_size : 0);
+	if (map && r->length>0 && r->length<=FILE_MAP_MAX) {
+		void *view = mmap(NULL, (size_t)r->length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view!=MAP_FAILED) {
+			r->data = (char *)view;
+			r->mapped = true;
+			return true;
+		}
+	}
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	r->buf_size = file_buf_size(r);
+	void *buf = mmap(NULL, r->buf_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf==MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+	r->data = (char *)buf;
+	return true;
+}
+
+bool file_open(FileReader *r, wchar_t *filepath, bool map) {
+	char path[MAXBUF];
+	if (wcstombs(path, filepath, MAXBUF)>=(size_t)MAXBUF) return false;
+	return file_open(r, path, map);
+}
+
+void file_close(FileReader *r) {
+	if (r->data!=NULL) munmap(r->data, r->mapped ? (size_t)r->length : r->buf_size);
+	close(r->file);
+	r->data = NULL;
+}
+
+size_t file_read(FileReader *r) {
+	ssize_t n;
+	do n = read(r->file, r->data, r->buf_size);
+	while (n<0 && errno==EINTR);
+	return (n<0) ? 0 : (size_t)n;
+}
+
+#endif
+
+// make the next block of the file available in r->data[0..r->size), false at the end
+bool file_next_block(FileReader *r) {
+	if (r->done) return false;
+	r->pos = 0;
+	if (r->mapped) {
+		r->size = (size_t)r->length;
+		r->done = true;
+		return true;
+	}
+	r->reads++;
+	size_t n = file_read(r);
+	if (n==0) {
+		r->size = 0;
+		r->done = true;
+		return false;
+	}
+	r->size = n;
+	r->offset += n;
+	if (r->offset>=r->length) r->done = true; // saves a read just to find the end
+	return true;
+}
+
+// next block of the file (whatever file_read_line() hasn't returned of the current one)
+bool file_read_block(FileReader *r, const char **data, size_t *count) {
+	if (r->pos==r->size && !file_next_block(r)) return false;
+	*data = r->data + r->pos;
+	*count = r->size - r->pos;
+	r->pos = r->size;
+	return true;
+}
+
+// next line of the file (with its "\n" or "\r\n", not '\0' terminated) as a pointer
+// into the file's data, or into r->line if the line is split between two streamed
+// blocks (only MAXBUF-1 chars of it are kept then)
+bool file_next_line(FileReader *r, const char **line, size_t *length) {
+	if (r->pos==r->size && !file_next_block(r)) return false;
+	const char *p = r->data + r->pos;
+	size_t count = r->size - r->pos;
+	const char *nl = (const char *)memchr(p, '\n', count);
+	if (nl!=NULL || r->done) {
+		*line = p;
+		*length = (nl==NULL) ? count : nl+1-p;
+		r->pos += *length;
+		return true;
+	}
+	// the line carries on in the next block
+	size_t n = min(count, (size_t)(MAXBUF-1));
+	memcpy(r->line, p, n);
+	r->pos = r->size;
+	while (nl==NULL && file_next_block(r)) {
+		nl = (const char *)memchr(r->data, '\n', r->size);
+		r->pos = (nl==NULL) ? r->size : nl+1-r->data;
+		size_t copy = min(r->pos, (size_t)(MAXBUF-1) - n);
+		memcpy(r->line+n, r->data, copy);
+		n += copy;
+	}
+	*line = r->line;
+	*length = n;
+	return true;
+}
+
+bool file_read_line(FileReader *r, char *line, int max) {
+	size_t n = 0;
+	const char *nl = NULL;
+	while (nl==NULL && n<(size_t)(max-1)) {
+		if (r->pos==r->size && !file_next_block(r)) break;
+		const char *p = r->data + r->pos;
+		size_t count = min(r->size - r->pos, (size_t)(max-1) - n);
+		nl = (const char *)memchr(p, '\n', count);
+		if (nl!=NULL) count = nl+1-p;
+		memcpy(line+n, p, count);
+		n += count;
+		r->pos += count;
+	}
+	if (n==0) return false;
+	// text mode "\r\n" -> "\n" (the '\n' may not have been read yet if the line was full)
+	if (n>=2 && nl!=NULL && line[n-2]=='\r') {
+		line[n-2] = '\n';
+		n--;
+	}
+	else if (nl==NULL && line[n-1]=='\r' && (r->pos<r->size || file_next_block(r)) && r->data[r->pos]=='\n') {
+		line[n-1] = '\n';
+		r->pos++;
+	}
+	line[n] = '\0';
+	return true;
+}
+
+
+
+//*******************************************************************************
+//********************** CHECKSUM CALCULATION ***********************************
+//*******************************************************************************
+
+// list of CHK_CHARS characters to be mapped into checksum (other chars ignored)
+const char *chk_source = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.abcdefghijklmnopqrstuvwxyz";
+// map table for char->int 0..(CHK_CHARS-1)
+int chk_map[CHK_CHARS]    = { 14,46,51,8,26,2,32,39,29,
+							 37,4,44,20,61,22,58,16,25,
+							 60,13,31,53,11,50,6,38,41,
+							 23,56,17,1,19,45,10,28,15,
+							 36,9,57,12,49,33,3,24,30,
+							 62,47,5,43,0,27,52,34,55,
+							 21,54,59,18,48,35,40,7,42};
+
+// chk_pos[] is the position of each byte value in chk_source, or CHK_INVALID
+// if that char is not checksummed. This table (and chk_map_mod below) is generated
+// from chk_source/chk_map so the checksum needs no search per input char.
+// chksum_tables_ok() confirms the tables still match chk_source and chk_map.
+const int CHK_INVALID = -1;
+const signed char chk_pos[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,36,-1, // '.'
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1, // '0'..'9'
+    -1,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24, // 'A'..'O'
+    25,26,27,28,29,30,31,32,33,34,35,-1,-1,-1,-1,-1, // 'P'..'Z'
+    -1,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51, // 'a'..'o'
+    52,53,54,55,56,57,58,59,60,61,62,-1,-1,-1,-1,-1, // 'p'..'z'
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
+
+// chk_map_mod[x] == chk_map[x % CHK_CHARS] for every x the checksum can produce,
+// i.e. up to num (62) + map_num (62) + lane (5), so the update needs no '%'
+const int CHK_MAP_MOD_SIZE = CHK_CHARS*2+CHKSUM_CHARS;
+const unsigned char chk_map_mod[CHK_MAP_MOD_SIZE] = {
+    14,46,51, 8,26, 2,32,39,29,37, 4,44,20,61,22,58,16,25,
+    60,13,31,53,11,50, 6,38,41,23,56,17, 1,19,45,10,28,15,
+    36, 9,57,12,49,33, 3,24,30,62,47, 5,43, 0,27,52,34,55,
+    21,54,59,18,48,35,40, 7,42,14,46,51, 8,26, 2,32,39,29,
+    37, 4,44,20,61,22,58,16,25,60,13,31,53,11,50, 6,38,41,
+    23,56,17, 1,19,45,10,28,15,36, 9,57,12,49,33, 3,24,30,
+    62,47, 5,43, 0,27,52,34,55,21,54,59,18,48,35,40, 7,42,
+    14,46,51, 8,26, 2};
+
+// check the generated tables against chk_source and chk_map
+bool chksum_tables_ok() {
+    for (int b=0; b<256; b++) {
+        const char *p = (b==0) ? NULL : strchr(chk_source, b);
+        int pos = (p==NULL) ? CHK_INVALID : (int)(p-chk_source);
+        if (chk_pos[b]!=pos) return false;
+    }
+    for (int x=0; x<CHK_MAP_MOD_SIZE; x++)
+        if (chk_map_mod[x]!=chk_map[x % CHK_CHARS]) return false;
+    return true;
+}
+
+// incrementally update checksum given current char c
+void incr_chksum(ChksumData *chk_data, char c) {
+	// convert c to int via chk_pos table
+	int c_pos = chk_pos[(unsigned char)c];
+	// if c not found then simply return (only need checksum valid chars)
+	if (c_pos==CHK_INVALID) return;
+
+	// now c_pos is index of c in char_source, get mapped number
+	int map_num = chk_map_mod[c_pos + chk_data->index % CHK_CHARS];
+	for (int i=0; i<CHKSUM_CHARS; i++) {
+		chk_data->num[i] = chk_map_mod[chk_data->num[i]+map_num+i];
+	}
+	// Increment checksum_index
+	chk_data->index = (chk_data->index + 1) % CHKSUM_MAX_INDEX;
+}
+
+// update checksum with a block of 'count' chars from buf
+// (gives exactly the same result as calling incr_chksum() for each char)
+void chksum_block_scalar(ChksumData *chk_data, const char *buf, size_t count) {
+	// work on local copies of the state so the compiler can keep them in registers
+	int index = chk_data->index;
+	int index_mod = index % CHK_CHARS; // index % CHK_CHARS, maintained without '%'
+	int n0 = chk_data->num[0], n1 = chk_data->num[1], n2 = chk_data->num[2];
+	int n3 = chk_data->num[3], n4 = chk_data->num[4], n5 = chk_data->num[5];
+	const unsigned char *p = (const unsigned char *)buf;
+	const unsigned char *end = p + count;
+
+	for (; p<end; p++) {
+		int c_pos = chk_pos[*p];
+		if (c_pos==CHK_INVALID) continue;
+		int map_num = chk_map_mod[c_pos + index_mod];
+		n0 = chk_map_mod[n0+map_num];
+		n1 = chk_map_mod[n1+map_num+1];
+		n2 = chk_map_mod[n2+map_num+2];
+		n3 = chk_map_mod[n3+map_num+3];
+		n4 = chk_map_mod[n4+map_num+4];
+		n5 = chk_map_mod[n5+map_num+5];
+		if (++index==CHKSUM_MAX_INDEX) {
+			index = 0;
+			index_mod = 0;
+		} else if (++index_mod==CHK_CHARS) index_mod = 0;
+	}
+	chk_data->index = index;
+	chk_data->num[0] = n0; chk_data->num[1] = n1; chk_data->num[2] = n2;
+	chk_data->num[3] = n3; chk_data->num[4] = n4; chk_data->num[5] = n5;
+}
+
+//*******************************************************************************
+// SSSE3 version of chksum_block()
+//
+// The six lanes can't usefully be updated with byte shuffles: each char's update
+// depends on the previous one, and the shuffle-based 63-entry lookup has a longer
+// latency than the scalar table lookups (it measured ~25% slower). The time that
+// CAN be saved is in deciding, byte by byte, which chars are checksummed at all
+// (a badly predicted branch for binary files like AIR and CumulusX.exe). So this
+// version classifies 16 bytes at a time, packs the chk_source positions of the
+// valid chars into a buffer with a shuffle, and then runs the lane update
+// over that buffer without any per-byte tests.
+
+const int CHKSUM_SIMD_CHUNK = 4096; // bytes classified before each lane update pass
+
+// chk_compact[mask] holds the byte positions of the bits set in 'mask', packed
+// to the front (0x80 fills the rest so pshufb writes zero), chk_popcount[mask]
+// the number of set bits. Built by chksum_init().
+unsigned char chk_compact[256][8];
+unsigned char chk_popcount[256];
+
+// set 'valid' to 0xFF for each byte of c that is in chk_source and return its position
+TARGET_SSSE3 inline __m128i chksum_classify_ssse3(__m128i c, __m128i *valid) {
+	__m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0')); // '0'..'9' -> 0..9
+	__m128i u = _mm_sub_epi8(c, _mm_set1_epi8('A')); // 'A'..'Z' -> 0..25
+	__m128i l = _mm_sub_epi8(c, _mm_set1_epi8('a')); // 'a'..'z' -> 0..25
+	__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+	__m128i is_upper = _mm_cmpeq_epi8(_mm_min_epu8(u, _mm_set1_epi8(25)), u);
+	__m128i is_lower = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(25)), l);
+	__m128i is_dot = _mm_cmpeq_epi8(c, _mm_set1_epi8('.'));
+	__m128i pos = _mm_and_si128(is_digit, d);
+	pos = _mm_or_si128(pos, _mm_and_si128(is_upper, _mm_add_epi8(u, _mm_set1_epi8(10))));
+	pos = _mm_or_si128(pos, _mm_and_si128(is_dot, _mm_set1_epi8(36)));
+	pos = _mm_or_si128(pos, _mm_and_si128(is_lower, _mm_add_epi8(l, _mm_set1_epi8(37))));
+	*valid = _mm_or_si128(_mm_or_si128(is_digit, is_upper), _mm_or_si128(is_lower, is_dot));
+	return pos;
+}
+
+// classify p..end (at most CHKSUM_SIMD_CHUNK bytes) and write the chk_source positions
+// of the valid chars to stream[], returning how many there were
+TARGET_SSSE3 size_t chksum_compact_ssse3(const unsigned char *p, const unsigned char *end, unsigned char *stream) {
+	size_t m = 0; // count of valid chars in stream[]
+
+	// classify and pack 16 bytes at a time
+	for (; p+16<=end; p+=16) {
+		__m128i valid;
+		__m128i pos = chksum_classify_ssse3(_mm_loadu_si128((const __m128i *)p), &valid);
+		int mask = _mm_movemask_epi8(valid);
+		if (mask==0) continue;
+		int lo = mask & 0xFF;
+		int hi = mask >> 8;
+		__m128i packed = _mm_shuffle_epi8(pos, _mm_loadl_epi64((const __m128i *)chk_compact[lo]));
+		_mm_storel_epi64((__m128i *)(stream+m), packed);
+		m += chk_popcount[lo];
+		packed = _mm_shuffle_epi8(_mm_srli_si128(pos, 8), _mm_loadl_epi64((const __m128i *)chk_compact[hi]));
+		_mm_storel_epi64((__m128i *)(stream+m), packed);
+		m += chk_popcount[hi];
+	}
+	// and the last few bytes
+	for (; p<end; p++) {
+		int c_pos = chk_pos[*p];
+		if (c_pos!=CHK_INVALID) stream[m++] = (unsigned char)c_pos;
+	}
+	return m;
+}
+
+TARGET_SSSE3 void chksum_block_ssse3(ChksumData *chk_data, const char *buf, size_t count) {
+	unsigned char stream[CHKSUM_SIMD_CHUNK+16]; // positions of valid chars (+16 for 8-byte stores)
+	const unsigned char *p = (const unsigned char *)buf;
+	const unsigned char *end = p + count;
+
+	while (p<end) {
+		const unsigned char *chunk_end = (end-p > CHKSUM_SIMD_CHUNK) ? p+CHKSUM_SIMD_CHUNK : end;
+		size_t m = chksum_compact_ssse3(p, chunk_end, stream);
+		p = chunk_end;
+
+		// lane update over the valid chars only
+		int index = chk_data->index;
+		int index_mod = index % CHK_CHARS;
+		int n0 = chk_data->num[0], n1 = chk_data->num[1], n2 = chk_data->num[2];
+		int n3 = chk_data->num[3], n4 = chk_data->num[4], n5 = chk_data->num[5];
+		for (size_t k=0; k<m; k++) {
+			int map_num = chk_map_mod[stream[k] + index_mod];
+			n0 = chk_map_mod[n0+map_num];
+			n1 = chk_map_mod[n1+map_num+1];
+			n2 = chk_map_mod[n2+map_num+2];
+			n3 = chk_map_mod[n3+map_num+3];
+			n4 = chk_map_mod[n4+map_num+4];
+			n5 = chk_map_mod[n5+map_num+5];
+			if (++index==CHKSUM_MAX_INDEX) {
+				index = 0;
+				index_mod = 0;
+			} else if (++index_mod==CHK_CHARS) index_mod = 0;
+		}
+		chk_data->index = index;
+		chk_data->num[0] = n0; chk_data->num[1] = n1; chk_data->num[2] = n2;
+		chk_data->num[3] = n3; chk_data->num[4] = n4; chk_data->num[5] = n5;
+	}
+}
+
+// count of the chars in buf that are included in the checksum
+TARGET_SSSE3 size_t chksum_count_valid(const char *buf, size_t count) {
+	const unsigned char *p = (const unsigned char *)buf;
+	const unsigned char *end = p + count;
+	size_t valid = 0;
+
+	for (; p+16<=end; p+=16) {
+		__m128i is_valid;
+		chksum_classify_ssse3(_mm_loadu_si128((const __m128i *)p), &is_valid);
+		int mask = _mm_movemask_epi8(is_valid);
+		valid += chk_popcount[mask & 0xFF] + chk_popcount[mask >> 8];
+	}
+	for (; p<end; p++) if (chk_pos[*p]!=CHK_INVALID) valid++;
+	return valid;
+}
+
+// checksum engine in use, chosen by chksum_init()
+void (*chksum_block_engine)(ChksumData *chk_data, const char *buf, size_t count) = chksum_block_scalar;
+bool chksum_ssse3 = false; // true if the CPU has SSSE3
+bool chksum_vbmi = false;  // true if the CPU (and OS) has AVX-512 VBMI
+int chksum_cpus = 1;       // number of CPUs available to chksum_parallel()
+
+// CPU features chksum_init() finds for the rest of sim_logger
+bool cpu_avx2 = false;     // true if the CPU (and OS) has AVX2 (for geo_legs())
+
+//*******************************************************************************
+// Checksum tables (for chksum_parallel() and the IGC file B records)
+//
+// For each lane the update num -> chk_map[(num+map_num+lane) % CHK_CHARS] is just a
+// map from 0..62 to 0..62, so the effect of a whole chunk of input on a lane can be
+// held as a 63-entry table, and applying the tables of successive chunks in order
+// gives the same result as checksumming straight through. map_num also depends on
+// the checksum index, but that only needs the count of valid chars before the chunk.
+//
+// A table is built by passing all 63 entries through each update at once, two
+// chars at a time via chk_pair[]. With SSSE3 each 64-entry lookup takes 16 shuffles
+// and the build is ~7x the work of chksum_block(); AVX-512 VBMI does the lookup
+// with one vpermb and the build is ~2x (see 'sim_logger bench'). chksum_table_cost
+// is that ratio, used to balance chksum_parallel().
+
+const int CHKSUM_TABLE_COST_SSSE3 = 7;
+const int CHKSUM_TABLE_COST_VBMI = 2;
+int chksum_table_cost = CHKSUM_TABLE_COST_SSSE3; // time of chksum_table_build() / chksum_block()
+
+// chk_step[a] is the lane update when map_num+lane == a, x -> chk_map[(x+a) % CHK_CHARS].
+// chk_pair[a*CHK_CHARS+b] is chk_step[a] followed by chk_step[b]. Each is 64 entries
+// (entry 63 is not used). Built by chksum_init(): for the SSSE3 table engine they are
+// held as four 16-byte rows for chksum_lookup64_ssse3(), with each row after the first
+// XOR'd with the one before.
+unsigned char chk_step[CHK_CHARS][64];
+unsigned char chk_pair[CHK_CHARS*CHK_CHARS][64];
+
+// look up each byte of idx (0..63) in a 64-byte table stored as in chk_step[]
+TARGET_SSSE3 inline __m128i chksum_lookup64_ssse3(const unsigned char *table, __m128i idx) {
+	// pshufb uses the low 4 bits of the index and gives 0 if bit 7 is set, so row k
+	// only contributes for idx >= 16*k, and XORing in the differenced rows 0..k
+	// leaves row k's entry
+	const __m128i row = _mm_set1_epi8(16);
+	__m128i r = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)table), idx);
+	for (int k=1; k<4; k++) {
+		idx = _mm_sub_epi8(idx, row);
+		r = _mm_xor_si128(r, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(table+16*k)), idx));
+	}
+	return r;
+}
+
+// apply 'count' updates (map_num values in steps[]) to every lane of table
+void chksum_table_steps_scalar(ChksumTable *table, const unsigned char *steps, size_t count) {
+	for (int lane=0; lane<CHKSUM_CHARS; lane++) {
+		for (size_t k=0; k<count; k++) {
+			int a = steps[k] + lane;
+			for (int x=0; x<CHK_CHARS; x++) table->map[lane][x] = chk_map_mod[table->map[lane][x] + a];
+		}
+	}
+}
+
+// SSSE3 version of chksum_table_steps_scalar()
+TARGET_SSSE3 void chksum_table_steps_ssse3(ChksumTable *table, const unsigned char *steps, size_t count) {
+	for (int lane=0; lane<CHKSUM_CHARS; lane++) {
+		__m128i t0 = _mm_loadu_si128((const __m128i *)(table->map[lane]));
+		__m128i t1 = _mm_loadu_si128((const __m128i *)(table->map[lane]+16));
+		__m128i t2 = _mm_loadu_si128((const __m128i *)(table->map[lane]+32));
+		__m128i t3 = _mm_loadu_si128((const __m128i *)(table->map[lane]+48));
+		size_t k = 0;
+		for (; k+2<=count; k+=2) {
+			int a = steps[k] + lane;
+			int b = steps[k+1] + lane;
+			if (a>=CHK_CHARS) a -= CHK_CHARS;
+			if (b>=CHK_CHARS) b -= CHK_CHARS;
+			const unsigned char *pair = chk_pair[a*CHK_CHARS+b];
+			t0 = chksum_lookup64_ssse3(pair, t0);
+			t1 = chksum_lookup64_ssse3(pair, t1);
+			t2 = chksum_lookup64_ssse3(pair, t2);
+			t3 = chksum_lookup64_ssse3(pair, t3);
+		}
+		if (k<count) {
+			int a = steps[k] + lane;
+			if (a>=CHK_CHARS) a -= CHK_CHARS;
+			t0 = chksum_lookup64_ssse3(chk_step[a], t0);
+			t1 = chksum_lookup64_ssse3(chk_step[a], t1);
+			t2 = chksum_lookup64_ssse3(chk_step[a], t2);
+			t3 = chksum_lookup64_ssse3(chk_step[a], t3);
+		}
+		_mm_storeu_si128((__m128i *)(table->map[lane]), t0);
+		_mm_storeu_si128((__m128i *)(table->map[lane]+16), t1);
+		_mm_storeu_si128((__m128i *)(table->map[lane]+32), t2);
+		_mm_storeu_si128((__m128i *)(table->map[lane]+48), t3);
+	}
+}
+
+// AVX-512 VBMI version of chksum_table_steps_ssse3(): each lane's table is one
+// register, so the lanes are updated together and the row index is worked out once
+// (g++ 12 warns about the _mm512_undefined_epi32() in its own _mm512_permutexvar_epi8())
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+TARGET_VBMI void chksum_table_steps_vbmi(ChksumTable *table, const unsigned char *steps, size_t count) {
+	__m512i t[CHKSUM_CHARS];
+	for (int lane=0; lane<CHKSUM_CHARS; lane++) t[lane] = _mm512_loadu_si512(table->map[lane]);
+	size_t k = 0;
+	for (; k+2<=count; k+=2) {
+		int a = steps[k];
+		int b = steps[k+1];
+		for (int lane=0; lane<CHKSUM_CHARS; lane++) {
+			t[lane] = _mm512_permutexvar_epi8(t[lane], _mm512_loadu_si512(chk_pair[a*CHK_CHARS+b]));
+			if (++a==CHK_CHARS) a = 0;
+			if (++b==CHK_CHARS) b = 0;
+		}
+	}
+	if (k<count) {
+		int a = steps[k];
+		for (int lane=0; lane<CHKSUM_CHARS; lane++) {
+			t[lane] = _mm512_permutexvar_epi8(t[lane], _mm512_loadu_si512(chk_step[a]));
+			if (++a==CHK_CHARS) a = 0;
+		}
+	}
+	for (int lane=0; lane<CHKSUM_CHARS; lane++) _mm512_storeu_si512(table->map[lane], t[lane]);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// table engine in use, chosen by chksum_init()
+void (*chksum_table_steps)(ChksumTable *table, const unsigned char *steps, size_t count) = chksum_table_steps_scalar;
+
+// set table to 'no chars yet'
+void chksum_table_reset(ChksumTable *table) {
+	table->valid = 0;
+	for (int lane=0; lane<CHKSUM_CHARS; lane++)
+		for (int x=0; x<64; x++) table->map[lane][x] = (unsigned char)x;
+}
+
+// add 'count' chars from buf to table, given the checksum index at the start of buf
+void chksum_table_extend(ChksumTable *table, const char *buf, size_t count, int index) {
+	unsigned char stream[CHKSUM_SIMD_CHUNK+16]; // positions of valid chars
+	unsigned char steps[CHKSUM_SIMD_CHUNK+1];   // their map_num values (+1 carried over)
+	const unsigned char *p = (const unsigned char *)buf;
+	const unsigned char *end = p + count;
+	int index_mod = index % CHK_CHARS;
+	size_t carry = 0; // 1 if steps[0] was left over from the last pass (odd count)
+
+	while (p<end) {
+		const unsigned char *chunk_end = (end-p > CHKSUM_SIMD_CHUNK) ? p+CHKSUM_SIMD_CHUNK : end;
+		size_t m = 0;
+		if (chksum_ssse3) m = chksum_compact_ssse3(p, chunk_end, stream);
+		else for (const unsigned char *q=p; q<chunk_end; q++)
+			if (chk_pos[*q]!=CHK_INVALID) stream[m++] = (unsigned char)chk_pos[*q];
+		p = chunk_end;
+		table->valid += m;
+
+		size_t n = carry;
+		for (size_t k=0; k<m; k++) {
+			steps[n++] = chk_map_mod[stream[k] + index_mod];
+			if (++index==CHKSUM_MAX_INDEX) {
+				index = 0;
+				index_mod = 0;
+			} else if (++index_mod==CHK_CHARS) index_mod = 0;
+		}
+		// keep an odd step back for the next pass so the steps go in pairs
+		carry = (p<end) ? (n & 1) : 0;
+		chksum_table_steps(table, steps, n - carry);
+		if (carry) steps[0] = steps[n-1];
+	}
+}
+
+// build the ChksumTable for 'count' chars from buf, given the checksum index at the start
+void chksum_table_build(ChksumTable *table, const char *buf, size_t count, int index) {
+	chksum_table_reset(table);
+	chksum_table_extend(table, buf, count, index);
+}
+
+// apply a chunk's table to the checksum
+void chksum_table_apply(ChksumData *chk_data, ChksumTable *table) {
+	for (int lane=0; lane<CHKSUM_CHARS; lane++)
+		chk_data->num[lane] = table->map[lane][chk_data->num[lane]];
+	chk_data->index = (int)((chk_data->index + table->valid) % CHKSUM_MAX_INDEX);
+}
+
+// build the SIMD tables and choose the checksum engine for this CPU
+// (called once at startup, before any checksum is calculated)
+void chksum_init() {
+	for (int mask=0; mask<256; mask++) {
+		int k = 0;
+		for (int bit=0; bit<8; bit++)
+			if (mask & (1<<bit)) chk_compact[mask][k++] = (unsigned char)bit;
+		chk_popcount[mask] = (unsigned char)k;
+		while (k<8) chk_compact[mask][k++] = 0x80;
+	}
+	int cpu_info[4];
+	cpu_id(cpu_info, 1, 0);
+	chksum_ssse3 = (cpu_info[2] & (1<<9)) != 0; // ECX bit 9 = SSSE3
+	chksum_block_engine = chksum_ssse3 ? chksum_block_ssse3 : chksum_block_scalar;
+	// AVX-512 VBMI needs AVX512F/BW/VBMI (leaf 7) and the OS saving the ZMM state (XCR0)
+	// and AVX2 the YMM state
+	bool osxsave = (cpu_info[2] & (1<<27)) != 0;
+	cpu_id(cpu_info, 0, 0);
+	if (osxsave && cpu_info[0]>=7 && (cpu_xcr0() & 0x06)==0x06) {
+		cpu_id(cpu_info, 7, 0);
+		cpu_avx2 = (cpu_info[1] & (1<<5)) != 0;
+		chksum_vbmi = (cpu_xcr0() & 0xE6)==0xE6 &&
+					  (cpu_info[1] & (1<<16)) && (cpu_info[1] & (1<<30)) && (cpu_info[2] & (1<<1));
+	}
+	if (chksum_vbmi) chksum_table_steps = chksum_table_steps_vbmi;
+	else if (chksum_ssse3) chksum_table_steps = chksum_table_steps_ssse3;
+	chksum_table_cost = chksum_vbmi ? CHKSUM_TABLE_COST_VBMI : CHKSUM_TABLE_COST_SSSE3;
+
+	chksum_cpus = cpu_count();
+	for (int a=0; a<CHK_CHARS; a++)
+		for (int b=0; b<CHK_CHARS; b++)
+			for (int x=0; x<64; x++)
+				chk_pair[a*CHK_CHARS+b][x] = (x<CHK_CHARS) ? chk_map_mod[chk_map_mod[x+a]+b] : 0;
+	for (int a=0; a<CHK_CHARS; a++)
+		for (int x=0; x<64; x++)
+			chk_step[a][x] = (x<CHK_CHARS) ? chk_map_mod[x+a] : 0;
+	// difference the rows for chksum_lookup64_ssse3()
+	if (!chksum_vbmi) for (int x=63; x>=16; x--) {
+		for (int a=0; a<CHK_CHARS; a++) chk_step[a][x] ^= chk_step[a][x-16];
+		for (int ab=0; ab<CHK_CHARS*CHK_CHARS; ab++) chk_pair[ab][x] ^= chk_pair[ab][x-16];
+	}
+}
+
+// update checksum with a block of 'count' chars from buf
+void chksum_block(ChksumData *chk_data, const char *buf, size_t count) {
+	chksum_block_engine(chk_data, buf, count);
+}
+
+//*******************************************************************************
+// Parallel checksum of large buffers
+//
+// The buffer is split into one chunk per CPU. Pass 1 counts the valid chars in each
+// chunk (on separate threads) to give the index each chunk starts at, pass 2 builds
+// the tables for chunks 1.. on separate threads while the calling thread checksums
+// chunk 0 directly, and then the tables are applied in order. Chunk 0 is given
+// chksum_table_cost times the share of the others so all the threads finish together.
+
+const size_t CHKSUM_PARALLEL_MIN = 8*1024*1024; // smallest buffer worth splitting
+
+// one chunk of a parallel checksum
+struct ChksumTask {
+	const char *buf;
+	size_t count;
+	int index;         // checksum index at the start of the chunk
+	ChksumTable table;
+	Thread thread;
+	bool started;      // the task is running on 'thread'
+};
+
+THREAD_PROC chksum_count_thread(void *arg) {
+	ChksumTask *task = (ChksumTask *)arg;
+	task->table.valid = chksum_count_valid(task->buf, task->count);
+	return THREAD_EXIT;
+}
+
+THREAD_PROC chksum_table_thread(void *arg) {
+	ChksumTask *task = (ChksumTask *)arg;
+	chksum_table_build(&task->table, task->buf, task->count, task->index);
+	return THREAD_EXIT;
+}
+
+// run func on tasks[1..count-1], each on its own thread (tasks[0] is left to the caller)
+void chksum_start_threads(ThreadProc func, ChksumTask *tasks, int count) {
+	for (int i=1; i<count; i++) {
+		tasks[i].started = thread_start(&tasks[i].thread, func, &tasks[i]);
+		if (!tasks[i].started) func(&tasks[i]); // couldn't start a thread so do it here
+	}
+}
+
+void chksum_wait_threads(ChksumTask *tasks, int count) {
+	for (int i=1; i<count; i++)
+		if (tasks[i].started) thread_wait(tasks[i].thread);
+}
+
+// update checksum with 'count' chars from buf split across 'threads' threads
+// (gives exactly the same result as chksum_block())
+void chksum_parallel(ChksumData *chk_data, const char *buf, size_t count, int threads) {
+	ChksumTask tasks[CHKSUM_MAX_THREADS];
+
+	if (threads>CHKSUM_MAX_THREADS) threads = CHKSUM_MAX_THREADS;
+	if (threads<2 || !chksum_ssse3) {
+		chksum_block(chk_data, buf, count);
+		return;
+	}
+
+	size_t share = count / (chksum_table_cost + threads - 1);
+	size_t start = 0;
+	for (int i=0; i<threads; i++) {
+		size_t chunk = (i==0) ? share*chksum_table_cost : share;
+		if (i==threads-1) chunk = count - start;
+		tasks[i].buf = buf + start;
+		tasks[i].count = chunk;
+		start += chunk;
+	}
+
+	// pass 1: valid char counts give each chunk's starting index (last chunk not needed)
+	chksum_start_threads(chksum_count_thread, tasks, threads-1);
+	chksum_count_thread(&tasks[0]);
+	chksum_wait_threads(tasks, threads-1);
+	tasks[0].index = chk_data->index;
+	for (int i=1; i<threads; i++)
+		tasks[i].index = (int)((tasks[i-1].index + tasks[i-1].table.valid) % CHKSUM_MAX_INDEX);
+
+	// pass 2: tables for chunks 1.., while this thread does chunk 0
+	chksum_start_threads(chksum_table_thread, tasks, threads);
+	chksum_block(chk_data, tasks[0].buf, tasks[0].count);
+	chksum_wait_threads(tasks, threads);
+
+	for (int i=1; i<threads; i++) chksum_table_apply(chk_data, &tasks[i].table);
+}
+
+// update checksum with a block of chars, using all the CPUs if the block is big
+void chksum_buffer(ChksumData *chk_data, const char *buf, size_t count) {
+	if (count>=CHKSUM_PARALLEL_MIN && chksum_cpus>1 && chksum_ssse3)
+		chksum_parallel(chk_data, buf, count, chksum_cpus);
+	else chksum_block(chk_data, buf, count);
+}
+
+// update chksum_num based on input string s
+void chksum_string(ChksumData *chk_data, const char *s) {
+	chksum_block(chk_data, s, strlen(s));
+}
+
+// update chksum_num based on BINARY input string s
+void chksum_binary(ChksumData *chk_data, char *s, int count) {
+	chksum_block(chk_data, s, count);
+}
+
+// convert chk_data.num[] into string chksum
+void chksum_to_string(char chksum[CHKSUM_CHARS+1], ChksumData chk_data) {
+	for (int i=0; i<CHKSUM_CHARS;i++) 
+		chksum[i] = chk_source[chk_data.num[i] % 36];
+}
+
+void chksum_reset(ChksumData *chk_data) {
+	chk_data->index = 1;
+	for (int i=0; i<CHKSUM_CHARS;i++) chk_data->num[i]=i;
+}
+
+//*******************************************************************************
+// Content hash
+//
+// The G record checksum has only 36^6 values and is slow to check, so
+// igc_write_file() also writes an XXH64 hash of the file (the bytes before the hash
+// record, as written) in an IGC_HASH_TAG L record just before the G record, where it
+// is covered by the G checksum. 'sim_logger verify fast' checks a file by its hash
+// when it has one, which runs at memory speed. The hash catches corruption and is
+// good for finding duplicate files but, unlike the G checksum, anyone can recompute
+// it, so a file that passes the hash check is reported as HASH_OK, not OK (it
+// doesn't count as verified), and a file that fails it (or has no hash) gets the
+// full G check.
+//
+// XXH64 (seed 0) is Yann Collet's xxHash, https://github.com/Cyan4973/xxHash
+
+const char IGC_HASH_TAG[] = "L FSX content hash (XXH64)    ";
+const size_t IGC_HASH_SEARCH = 1024; // the hash record is within this many bytes of the end
+
+const UINT64 XXH_PRIME1 = 11400714785074694791ULL;
+const UINT64 XXH_PRIME2 = 14029467366897019727ULL;
+const UINT64 XXH_PRIME3 = 1609587929392839161ULL;
+const UINT64 XXH_PRIME4 = 9650029242287828579ULL;
+const UINT64 XXH_PRIME5 = 2870177450012600261ULL;
+
+inline UINT64 xxh64_read64(const unsigned char *p) {
+	UINT64 x;
+	memcpy(&x, p, 8); // (x86 is little-endian, as XXH64 reads its input)
+	return x;
+}
+
+inline UINT64 xxh64_read32(const unsigned char *p) {
+	UINT32 x;
+	memcpy(&x, p, 4);
+	return x;
+}
+
+inline UINT64 xxh64_round(UINT64 acc, UINT64 input) {
+	acc += input * XXH_PRIME2;
+	return _rotl64(acc, 31) * XXH_PRIME1;
+}
+
+inline UINT64 xxh64_merge(UINT64 h, UINT64 v) {
+	h ^= xxh64_round(0, v);
+	return h * XXH_PRIME1 + XXH_PRIME4;
+}
+
+void xxh64_reset(Xxh64State *s) {
+	s->total = 0;
+	s->v[0] = XXH_PRIME1 + XXH_PRIME2;
+	s->v[1] = XXH_PRIME2;
+	s->v[2] = 0;
+	s->v[3] = 0 - XXH_PRIME1;
+	s->mem_size = 0;
+}
+
+void xxh64_update(Xxh64State *s, const char *buf, size_t count) {
+	const unsigned char *p = (const unsigned char *)buf;
+	const unsigned char *end = p + count;
+
+	s->total += count;
+	if (s->mem_size + count < 32) {
+		memcpy(s->mem + s->mem_size, p, count);
+		s->mem_size += count;
+		return;
+	}
+	if (s->mem_size>0) {
+		size_t fill = 32 - s->mem_size;
+		memcpy(s->mem + s->mem_size, p, fill);
+		p += fill;
+		for (int i=0; i<4; i++) s->v[i] = xxh64_round(s->v[i], xxh64_read64(s->mem + 8*i));
+		s->mem_size = 0;
+	}
+	UINT64 v0 = s->v[0], v1 = s->v[1], v2 = s->v[2], v3 = s->v[3];
+	while (end-p >= 32) {
+		v0 = xxh64_round(v0, xxh64_read64(p));
+		v1 = xxh64_round(v1, xxh64_read64(p+8));
+		v2 = xxh64_round(v2, xxh64_read64(p+16));
+		v3 = xxh64_round(v3, xxh64_read64(p+24));
+		p += 32;
+	}
+	s->v[0] = v0; s->v[1] = v1; s->v[2] = v2; s->v[3] = v3;
+	memcpy(s->mem, p, end-p);
+	s->mem_size = end-p;
+}
+
+// add text to the hash as fputs() writes it to a text mode file ("\n" -> "\r\n")
+void xxh64_update_text(Xxh64State *s, const char *text) {
+	const char *nl;
+	while ((nl = strchr(text, '\n'))!=NULL) {
+		xxh64_update(s, text, nl-text);
+		xxh64_update(s, "\r\n", 2);
+		text = nl+1;
+	}
+	xxh64_update(s, text, strlen(text));
+}
+
+UINT64 xxh64_digest(Xxh64State *s) {
+	const unsigned char *p = s->mem;
+	const unsigned char *end = s->mem + s->mem_size;
+	UINT64 h;
+
+	if (s->total>=32) {
+		h = _rotl64(s->v[0], 1) + _rotl64(s->v[1], 7) + _rotl64(s->v[2], 12) + _rotl64(s->v[3], 18);
+		for (int i=0; i<4; i++) h = xxh64_merge(h, s->v[i]);
+	}
+	else h = s->v[2] + XXH_PRIME5; // (v[2] is still the seed)
+	h += s->total;
+	for (; end-p >= 8; p += 8) {
+		h ^= xxh64_round(0, xxh64_read64(p));
+		h = _rotl64(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+	}
+	if (end-p >= 4) {
+		h ^= xxh64_read32(p) * XXH_PRIME1;
+		h = _rotl64(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+		p += 4;
+	}
+	for (; p<end; p++) {
+		h ^= *p * XXH_PRIME5;
+		h = _rotl64(h, 11) * XXH_PRIME1;
+	}
+	h ^= h >> 33;
+	h *= XXH_PRIME2;
+	h ^= h >> 29;
+	h *= XXH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+UINT64 xxh64(const char *buf, size_t count) {
+	Xxh64State s;
+	xxh64_reset(&s);
+	xxh64_update(&s, buf, count);
+	return xxh64_digest(&s);
+}
+
+// true if the IGC file has a content hash record and the hash matches
+bool igc_content_hash_ok(char *filepath) {
+	FileReader r;
+	const char *data;
+	size_t count;
+	size_t tag_len = strlen(IGC_HASH_TAG);
+	bool ok = false;
+
+	if (!file_open(&r, filepath)) return false;
+	// (only a mapped file is read as one block - bigger files get the G check)
+	if (r.mapped && file_read_block(&r, &data, &count)) {
+		const char *end = data + count;
+		const char *line = end - min(count, IGC_HASH_SEARCH);
+		while (line<end) {
+			if ((line==data || line[-1]=='\n') && (size_t)(end-line)>=tag_len+16 &&
+				memcmp(line, IGC_HASH_TAG, tag_len)==0) {
+				char hex[17];
+				memcpy(hex, line+tag_len, 16);
+				hex[16] = '\0';
+				ok = xxh64(data, line-data)==_strtoui64(hex, NULL, 16);
+				break;
+			}
+			line = (const char *)memchr(line, '\n', end-line);
+			line = (line==NULL) ? end : line+1;
+		}
+	}
+	file_close(&r);
+	return ok;
+}
+
+//*******************************************************************************
+//********************** IGC FILE CHECKSUM **************************************
+//*******************************************************************************
+
+// check the G record in line_buf against chk_data, the checksum of the file before it
+CHKSUM_RESULT chksum_igc_g_record(char chksum[CHKSUM_CHARS+1], ChksumData chk_data, char *line_buf) {
+	if (line_buf[0]!='G') {
+			return CHKSUM_NOT_FOUND;
+	}
+
+	if (strlen(line_buf)<CHKSUM_CHARS+1) {
+			return CHKSUM_TOO_SHORT;
+	}
+	chksum_to_string(chksum, chk_data);
+	for (int i=0; i<CHKSUM_CHARS; i++) {
+		if (chksum[i]!=line_buf[i+1]) {
+			return CHKSUM_BAD;
+		}
+	}
+	return CHKSUM_OK;
+}
+
+// This routine is used to *check* the checksum at the end of an IGC file
+// the checksum will be stored in the final 'G' record.
+// Only alphanumeric characters before the 'G' record contribute to the checksum.
+CHKSUM_RESULT chksum_igc_file(char chksum[CHKSUM_CHARS+1], char *filepath) {
+	FileReader r;
+	const char *data;
+	size_t count;
+	bool line_start = true; // next block starts at the start of a line
+	char line_buf[MAXBUF];
+	// calculated checksum as sequence of ints 0..CHK_CHARS
+	ChksumData chk_data;
+	
+	chksum_reset(&chk_data);
+	line_buf[0] = '\0';
+
+    // open file
+	if (!file_open(&r, filepath)) {
+		return CHKSUM_FILE_ERROR;
+	}
+	// checksum the file in whole blocks up to the first line starting with 'G'
+	while (file_read_block(&r, &data, &count)) {
+		const char *end = data + count;
+		const char *g = data;
+		if (!line_start) {
+			g = (const char *)memchr(g, '\n', end-g);
+			g = (g==NULL) ? end : g+1;
+		}
+		while (g<end && *g!='G') {
+			g = (const char *)memchr(g, '\n', end-g);
+			g = (g==NULL) ? end : g+1;
+		}
+		chksum_buffer(&chk_data, data, g-data);
+		if (g<end) {
+			// read the G record into line_buf from where it starts
+			r.pos = g - r.data;
+			file_read_line(&r, line_buf, MAXBUF);
+			break;
+		}
+		line_start = (count>0 && end[-1]=='\n');
+	}
+    // close file
+	file_close(&r);
+
+	return chksum_igc_g_record(chksum, chk_data, line_buf);
+}
+
+void igc_reader_reset(IgcReader *r) {
+	chksum_reset(&r->chk_data);
+	r->g_found = false;
+	r->g_record[0] = '\0';
+}
+
+bool igc_reader_open(IgcReader *r, wchar_t *filepath) {
+	igc_reader_reset(r);
+	return file_open(&r->file, filepath);
+}
+
+bool igc_reader_open(IgcReader *r, char *filepath) {
+	igc_reader_reset(r);
+	return file_open(&r->file, filepath);
+}
+
+bool igc_reader_line(IgcReader *r, char *line_buf, int max) {
+	if (!file_read_line(&r->file, line_buf, max)) return false;
+	if (r->g_found) return true;
+	if (line_buf[0]=='G') {
+		r->g_found = true;
+		strcpy_s(r->g_record, MAXBUF, line_buf);
+	}
+	else chksum_string(&r->chk_data, line_buf);
+	return true;
+}
+
+// as igc_reader_line() but without copying the line (see file_next_line())
+bool igc_reader_next(IgcReader *r, const char **line, size_t *length) {
+	if (!file_next_line(&r->file, line, length)) return false;
+	if (r->g_found) return true;
+	if ((*line)[0]=='G') {
+		size_t n = min(*length, (size_t)(MAXBUF-1));
+		memcpy(r->g_record, *line, n);
+		r->g_record[n] = '\0';
+		r->g_found = true;
+	}
+	else chksum_block(&r->chk_data, *line, *length);
+	return true;
+}
+
+CHKSUM_RESULT igc_reader_close(IgcReader *r) {
+	char chksum[CHKSUM_CHARS+1] = "000000";
+	file_close(&r->file);
+	return chksum_igc_g_record(chksum, r->chk_data, r->g_record);
+}
+
+CHKSUM_RESULT check_file(char *pfilepath) {
+	char chksum[CHKSUM_CHARS+1] = "000000";
+	return chksum_igc_file(chksum, pfilepath);
+}
+
+//*********************************************************************************************
+//*********************************************************************************************
+// **********************************   BATCH VERIFY   ****************************************
+//*********************************************************************************************
+//*********************************************************************************************
+// 'sim_logger verify [fast] [csv|json] path ...' checks the G record checksum of every IGC
+// file given (a path can be a file, a folder, searched with its subfolders for *.igc
+// files, or a wildcard such as day1\*.igc) and prints a report with each file's
+// CHKSUM_RESULT and the checksums from its L records, CSV (the default) or JSON.
+// 'verify fast' checks files by their content hash where they have one (the report's
+// 'check' is "hash" for those, "G" for files given the G record check). A matching
+// hash is reported as HASH_OK, and as the hash can be recomputed by anyone who edits
+// the file, only files whose G record checks OK count as verified for the exit code.
+// The files are shared between chksum_cpus threads, each taking the next unchecked
+// file as it finishes the last one. Like 'bench' this doesn't need FSX, and it's
+// also built on its own as sim_logger_verify (sim_logger_verify.cpp, see README.md).
+
+const int VERIFY_L_RECORDS = 6;
+// the L records whose checksums are reported, and their names in the report
+const char *verify_l_tags[VERIFY_L_RECORDS] = {
+	"L FSX GENERAL CHECKSUM",
+	"L FSX FLT checksum",
+	"L FSX WX checksum",
+	"L FSX CMX checksum",
+	"L FSX AIR checksum",
+	"L FSX aircraft.cfg checksum" };
+const char *verify_l_names[VERIFY_L_RECORDS] = { "general", "flt", "wx", "cmx", "air", "cfg" };
+
+struct VerifyFile {
+	char filepath[MAXBUF];
+	CHKSUM_RESULT result;
+	bool hash_checked; // result is from the content hash, not the G record
+	char l_chksum[VERIFY_L_RECORDS][CHKSUM_CHARS+1]; // "" if the L record isn't in the file
+};
+
+bool verify_fast = false; // check by content hash when the file has one
+VerifyFile *verify_files = NULL;
+int verify_count = 0;
+int verify_max = 0;
+volatile long verify_next = 0; // index of the next file for verify_thread()
+
+const char *verify_result_name(CHKSUM_RESULT result) {
+	switch (result) {
+		case CHKSUM_OK:         return "OK";
+		case CHKSUM_NOT_FOUND:  return "NOT_FOUND";
+		case CHKSUM_TOO_SHORT:  return "TOO_SHORT";
+		case CHKSUM_BAD:        return "BAD";
+		case CHKSUM_FILE_ERROR: return "FILE_ERROR";
+	}
+	return "?";
+}
+
+void verify_add_file(char *filepath) {
+	if (verify_count==verify_max) {
+		int new_max = (verify_max==0) ? 256 : verify_max*2;
+		VerifyFile *files = (VerifyFile *)realloc(verify_files, new_max*sizeof(VerifyFile));
+		if (files==NULL) {
+			fprintf(stderr, "Out of memory after %d files\n", verify_count);
+			return;
+		}
+		verify_files = files;
+		verify_max = new_max;
+	}
+	VerifyFile *v = &verify_files[verify_count++];
+	strcpy_s(v->filepath, MAXBUF, filepath);
+	v->result = CHKSUM_FILE_ERROR;
+	v->hash_checked = false;
+	for (int i=0; i<VERIFY_L_RECORDS; i++) v->l_chksum[i][0] = '\0';
+}
+
+// true if name matches the wildcard pattern ('*' and '?', any case, as Windows does)
+bool verify_match(const char *pattern, const char *name) {
+	if (*pattern=='\0') return *name=='\0';
+	if (*pattern=='*') return verify_match(pattern+1, name) || (*name!='\0' && verify_match(pattern, name+1));
+	if (*name=='\0') return false;
+	if (*pattern!='?' && tolower((unsigned char)*pattern)!=tolower((unsigned char)*name)) return false;
+	return verify_match(pattern+1, name+1);
+}
+
+// add the files matching pattern (e.g. "day1\*.igc"), and if recurse is set search
+// the subfolders of the pattern's folder for the same file name pattern
+void verify_add_pattern(char *pattern, bool recurse) {
+	char dir[MAXBUF];
+	char sub_dir[MAXBUF];
+	char path[MAXBUF];
+	const char *file_name;
+	bool is_dir;
+
+	// dir is the folder part of pattern, including its trailing '\'
+	strcpy_s(dir, MAXBUF, pattern);
+	char *name = dir;
+	for (char *c=dir; *c!='\0'; c++) if (*c=='\\' || *c=='/') name = c+1;
+	*name = '\0';
+	char *file_pattern = pattern + (name-dir);
+
+	PathList *list = path_list(dir);
+	if (list==NULL) return;
+	while (path_next(list, &file_name, &is_dir)) {
+		if (is_dir || !verify_match(file_pattern, file_name)) continue;
+		if (path_join(path, dir, file_name)) verify_add_file(path);
+		else fprintf(stderr, "Path too long: %s%s\n", dir, file_name);
+	}
+	path_list_close(list);
+	if (!recurse) return;
+	list = path_list(dir);
+	if (list==NULL) return;
+	while (path_next(list, &file_name, &is_dir)) {
+		if (!is_dir || strcmp(file_name, ".")==0 || strcmp(file_name, "..")==0) continue;
+		if (path_join(sub_dir, dir, file_name, PATH_SEP) && path_join(path, sub_dir, file_pattern))
+			verify_add_pattern(path, true);
+		else fprintf(stderr, "Path too long: %s%s\n", dir, file_name);
+	}
+	path_list_close(list);
+}
+
+void verify_add_path(char *path) {
+	char pattern[MAXBUF];
+	size_t len = strlen(path);
+	if (len>=(size_t)MAXBUF) fprintf(stderr, "Path too long: %s\n", path);
+	else if (strpbrk(path, "*?")!=NULL) verify_add_pattern(path, false);
+	else if (path_is_dir(path)) {
+		bool slash = len>0 && (path[len-1]=='\\' || path[len-1]=='/');
+		if (path_join(pattern, path, slash ? "" : PATH_SEP, "*.igc")) verify_add_pattern(pattern, true);
+		else fprintf(stderr, "Path too long: %s\n", path);
+	}
+	else verify_add_file(path); // (a missing file is reported as FILE_ERROR)
+}
+
+// a file's full path and its place in verify_files[], for verify_remove_duplicates()
+struct VerifyKey {
+	char path[MAXBUF];
+	int index;
+};
+
+int verify_key_compare(const void *a, const void *b) {
+	const VerifyKey *ka = (const VerifyKey *)a;
+	const VerifyKey *kb = (const VerifyKey *)b;
+	int c = path_compare(ka->path, kb->path);
+	return (c!=0) ? c : ka->index - kb->index;
+}
+
+// drop the files given more than once (e.g. by a folder and a wildcard), keeping
+// the first of each in its place
+void verify_remove_duplicates() {
+	VerifyKey *keys = (VerifyKey *)malloc(verify_count*sizeof(VerifyKey));
+	bool *dup = (bool *)calloc(verify_count, sizeof(bool));
+	int count = 0;
+
+	if (keys!=NULL && dup!=NULL) {
+		for (int i=0; i<verify_count; i++) {
+			path_full(keys[i].path, verify_files[i].filepath);
+			keys[i].index = i;
+		}
+		qsort(keys, verify_count, sizeof(VerifyKey), verify_key_compare);
+		for (int i=1; i<verify_count; i++)
+			if (path_compare(keys[i].path, keys[i-1].path)==0) dup[keys[i].index] = true;
+		for (int i=0; i<verify_count; i++)
+			if (!dup[i]) verify_files[count++] = verify_files[i];
+		if (count<verify_count) fprintf(stderr, "%d files given more than once\n", verify_count-count);
+		verify_count = count;
+	}
+	free(keys);
+	free(dup);
+}
+
+// if line_buf is the L record tag, copy the checksum that follows it to chksum
+bool verify_l_record(char *line_buf, const char *tag, char chksum[CHKSUM_CHARS+1]) {
+	size_t len = strlen(tag);
+	if (strncmp(line_buf, tag, len)!=0) return false;
+	char *p = line_buf + len;
+	while (*p==' ') p++;
+	size_t n = min(strcspn(p, " \r\n"), (size_t)CHKSUM_CHARS);
+	strncpy_s(chksum, CHKSUM_CHARS+1, p, n);
+	return true;
+}
+
+// copy the checksum from line_buf if it's one of the reported L records
+void verify_l_records(VerifyFile *v, char *line_buf) {
+	if (line_buf[0]!='L') return;
+	for (int i=0; i<VERIFY_L_RECORDS; i++)
+		if (verify_l_record(line_buf, verify_l_tags[i], v->l_chksum[i])) return;
+}
+
+// result name for the report
+const char *verify_file_result(VerifyFile *v) {
+	if (v->hash_checked && v->result==CHKSUM_OK) return "HASH_OK";
+	return verify_result_name(v->result);
+}
+
+// the G record checked OK (HASH_OK isn't enough)
+bool verify_file_ok(VerifyFile *v) {
+	return v->result==CHKSUM_OK && !v->hash_checked;
+}
+
+// check the G record and read the L records in one pass
+void verify_file(VerifyFile *v) {
+	char line_buf[MAXBUF];
+	IgcReader r;
+
+	if (verify_fast && igc_content_hash_ok(v->filepath)) {
+		// the hash matches, so the L records are only read from the header
+		FileReader f;
+		v->result = CHKSUM_OK;
+		v->hash_checked = true;
+		if (!file_open(&f, v->filepath)) return;
+		while (file_read_line(&f, line_buf, MAXBUF) && line_buf[0]!='B') verify_l_records(v, line_buf);
+		file_close(&f);
+		return;
+	}
+	if (!igc_reader_open(&r, v->filepath)) {
+		v->result = CHKSUM_FILE_ERROR;
+		return;
+	}
+	while (igc_reader_line(&r, line_buf, MAXBUF)) {
+		if (!r.g_found) verify_l_records(v, line_buf);
+	}
+	v->result = igc_reader_close(&r);
+}
+
+THREAD_PROC verify_thread(void *) {
+	long i;
+	while ((i = thread_increment(&verify_next)-1) < verify_count)
+		verify_file(&verify_files[i]);
+	return THREAD_EXIT;
+}
+
+// print s as a quoted CSV or JSON string (the file paths and L record checksums
+// come from the files being checked, so may have any chars in them)
+void verify_print_string(char *s, bool json) {
+	putchar('"');
+	for (; *s!='\0'; s++) {
+		if (*s=='"') printf(json ? "\\\"" : "\"\"");
+		else if (*s=='\\' && json) printf("\\\\");
+		else if ((unsigned char)*s<' ' && json) printf("\\u%04x", *s);
+		else putchar(*s);
+	}
+	putchar('"');
+}
+
+void verify_report(bool json) {
+	if (json) printf("[\n");
+	else {
+		printf("file,result,check");
+		for (int j=0; j<VERIFY_L_RECORDS; j++) printf(",%s", verify_l_names[j]);
+		printf("\n");
+	}
+	for (int i=0; i<verify_count; i++) {
+		VerifyFile *v = &verify_files[i];
+		if (json) {
+			printf("  {\"file\": ");
+			verify_print_string(v->filepath, true);
+			printf(", \"result\": \"%s\", \"check\": \"%s\"", verify_file_result(v),
+				v->hash_checked ? "hash" : "G");
+			for (int j=0; j<VERIFY_L_RECORDS; j++) {
+				printf(", \"%s\": ", verify_l_names[j]);
+				verify_print_string(v->l_chksum[j], true);
+			}
+			printf("}%s\n", i<verify_count-1 ? "," : "");
+		}
+		else {
+			verify_print_string(v->filepath, false);
+			printf(",%s,%s", verify_file_result(v), v->hash_checked ? "hash" : "G");
+			for (int j=0; j<VERIFY_L_RECORDS; j++) {
+				putchar(',');
+				verify_print_string(v->l_chksum[j], false);
+			}
+			printf("\n");
+		}
+	}
+	if (json) printf("]\n");
+}
+
+// returns 0 if every file's G record checks OK, 1 otherwise
+int verify_main(int argc, char* argv[]) {
+	bool json = false;
+	Thread threads[CHKSUM_MAX_THREADS];
+	int thread_count = 0;
+	int ok = 0;
+	int hash_ok = 0;
+
+	verify_fast = argc>0 && strcmp(argv[0],"fast")==0;
+	if (verify_fast) {
+		argc--;
+		argv++;
+	}
+	if (argc>0 && (strcmp(argv[0],"json")==0 || strcmp(argv[0],"csv")==0)) {
+		json = strcmp(argv[0],"json")==0;
+		argc--;
+		argv++;
+	}
+	if (argc==0) {
+		fprintf(stderr, "usage: sim_logger verify [fast] [csv|json] file|folder|wildcard ...\n");
+		return 1;
+	}
+	for (int i=0; i<argc; i++) verify_add_path(argv[i]);
+	verify_remove_duplicates();
+	if (verify_count==0) {
+		fprintf(stderr, "No IGC files found\n");
+		return 1;
+	}
+
+	double t = perf_seconds();
+	verify_next = 0;
+	for (int i=1; i<min(chksum_cpus, CHKSUM_MAX_THREADS) && i<verify_count; i++) {
+		if (thread_start(&threads[thread_count], verify_thread, NULL)) thread_count++;
+	}
+	verify_thread(NULL); // this thread checks files too
+	for (int i=0; i<thread_count; i++) thread_wait(threads[i]);
+	t = perf_seconds() - t;
+
+	verify_report(json);
+	for (int i=0; i<verify_count; i++) {
+		if (verify_file_ok(&verify_files[i])) ok++;
+		else if (verify_files[i].result==CHKSUM_OK) hash_ok++;
+	}
+	fprintf(stderr, "%d files checked in %.2f s on %d threads: %d OK, %d HASH_OK (G record not checked), %d not OK\n",
+		verify_count, t, thread_count+1, ok, hash_ok, verify_count-ok-hash_ok);
+	free(verify_files);
+	return (ok==verify_count) ? 0 : 1;
+}
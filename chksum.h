@@ -0,0 +1,236 @@
+//------------------------------------------------------------------------------
+//						sim_logger
+//  chksum.h - IGC checksum, FileReader and batch verify (chksum.cpp)
+//
+//  Description:
+//              the parts of sim_logger that don't need FSX or SimConnect, so
+//              'sim_logger verify' can also be built on Linux (see README.md)
+//
+//              Written by Ian Forster-Lewis www.forsterlewis.com
+//------------------------------------------------------------------------------
+
+#ifndef CHKSUM_H
+#define CHKSUM_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdint.h>
+#include <pthread.h>
+#endif
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//********************************************************************************
+//********************   PLATFORM                 ********************************
+//********************************************************************************
+// chksum.cpp is built with MSVC for sim_logger.exe and with g++ (POSIX) for the
+// Linux sim_logger_verify. Everything that differs between the two is here and in
+// the PLATFORM section of chksum.cpp.
+
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef unsigned (__stdcall *ThreadProc)(void *);
+#define THREAD_PROC unsigned __stdcall // e.g. THREAD_PROC my_thread(void *arg)
+#define THREAD_EXIT 0                  // ...returned by a THREAD_PROC
+const char PATH_SEP[] = "\\";
+#else
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef pthread_t Thread;
+typedef void *(*ThreadProc)(void *);
+#define THREAD_PROC void *
+#define THREAD_EXIT NULL
+const char PATH_SEP[] = "/";
+
+// the MSVC library functions sim_logger uses
+#ifndef min
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#define sprintf_s snprintf
+#define _strtoui64 strtoull
+
+inline int strcpy_s(char *dest, size_t size, const char *src) {
+	snprintf(dest, size, "%s", src);
+	return 0;
+}
+
+inline int strncpy_s(char *dest, size_t size, const char *src, size_t count) {
+	size_t n = strnlen(src, count);
+	if (n>=size) n = size-1;
+	memcpy(dest, src, n);
+	dest[n] = '\0';
+	return 0;
+}
+
+inline UINT64 _rotl64(UINT64 x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+#endif
+
+// high resolution timer (seconds) used for the debug timings and benchmarks
+double perf_seconds();
+// run func(arg) on a new thread, false if it couldn't be started
+bool thread_start(Thread *thread, ThreadProc func, void *arg);
+void thread_wait(Thread thread);
+// add 1 to *value (from any thread) and return the new value
+long thread_increment(volatile long *value);
+// true if path is a folder
+bool path_is_dir(const char *path);
+// path = a+b+c, false (path unset) if that's MAXBUF chars or more
+bool path_join(char *path, const char *a, const char *b, const char *c = "");
+// the full path of path, or path itself if it can't be found
+void path_full(char *full, const char *path);
+// strcmp() for paths (ignoring case on Windows)
+int path_compare(const char *a, const char *b);
+
+// a folder listing for path_next()
+struct PathList;
+// list the folder dir ("" for the current folder), NULL if it can't be read
+PathList *path_list(const char *dir);
+// next name in the listing, false at the end
+bool path_next(PathList *list, const char **name, bool *is_dir);
+void path_list_close(PathList *list);
+
+//*******************************************************************************
+//****************************  FILE READER  ************************************
+//*******************************************************************************
+
+const int MAXBUF = 1000; // max length of an IGC file line or a filename
+
+struct FileReader {
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;  // NULL if the file is being streamed
+#else
+	int file;        // file descriptor
+#endif
+	bool mapped;     // data is the whole file, memory-mapped
+	char *data;      // the mapped view, or the streaming buffer
+	size_t size;     // bytes available in data (0 until the first block is read)
+	size_t pos;      // file_read_line() position in data
+	size_t buf_size; // size of the streaming buffer
+	INT64 length;    // file length in bytes
+	INT64 offset;    // bytes read so far when streaming
+	bool done;       // no more blocks
+	int reads;       // read calls, for 'sim_logger bench io'
+	char line[MAXBUF]; // file_next_line() copy of a line split between two blocks
+};
+
+bool file_open(FileReader *r, char *filepath, bool map = true);
+bool file_open(FileReader *r, wchar_t *filepath, bool map = true);
+void file_close(FileReader *r);
+bool file_read_block(FileReader *r, const char **data, size_t *count);
+bool file_next_line(FileReader *r, const char **line, size_t *length);
+bool file_read_line(FileReader *r, char *line, int max);
+
+//*******************************************************************************
+//********************** CHECKSUM CALCULATION ***********************************
+//*******************************************************************************
+
+// length of checksum string
+const int CHKSUM_CHARS = 6;
+
+// return codes from chksum_igc_file()
+enum CHKSUM_RESULT {
+    CHKSUM_OK,
+	CHKSUM_NOT_FOUND,
+	CHKSUM_TOO_SHORT,
+	CHKSUM_BAD,
+	CHKSUM_FILE_ERROR,
+};
+
+const int CHK_CHARS = 63; // number of chars in chk_source and chk_map
+extern const char *chk_source;
+extern int chk_map[CHK_CHARS];
+
+// modulo value for chksum_index which increments through the file
+const int CHKSUM_MAX_INDEX = 1987;
+
+struct ChksumData {
+	int index;
+	int num[CHKSUM_CHARS];
+};
+
+// the effect of a chunk of input: lane value at the start -> lane value at the end
+// (see chksum_table_build())
+struct ChksumTable {
+	size_t valid; // number of checksummed chars in the chunk
+	unsigned char map[CHKSUM_CHARS][64];
+};
+
+const int CHKSUM_MAX_THREADS = 16;
+
+extern bool chksum_ssse3;      // true if the CPU has SSSE3
+extern bool chksum_vbmi;       // true if the CPU (and OS) has AVX-512 VBMI
+extern int chksum_cpus;        // number of CPUs available to chksum_parallel()
+extern bool cpu_avx2;          // true if the CPU (and OS) has AVX2 (for geo_legs())
+extern int chksum_table_cost;  // time of chksum_table_build() / chksum_block()
+
+void chksum_init();
+bool chksum_tables_ok();
+void incr_chksum(ChksumData *chk_data, char c);
+void chksum_block_scalar(ChksumData *chk_data, const char *buf, size_t count);
+void chksum_block_ssse3(ChksumData *chk_data, const char *buf, size_t count);
+void chksum_block(ChksumData *chk_data, const char *buf, size_t count);
+void chksum_table_reset(ChksumTable *table);
+void chksum_table_extend(ChksumTable *table, const char *buf, size_t count, int index);
+void chksum_table_build(ChksumTable *table, const char *buf, size_t count, int index);
+void chksum_table_apply(ChksumData *chk_data, ChksumTable *table);
+void chksum_parallel(ChksumData *chk_data, const char *buf, size_t count, int threads);
+void chksum_buffer(ChksumData *chk_data, const char *buf, size_t count);
+void chksum_string(ChksumData *chk_data, const char *s);
+void chksum_binary(ChksumData *chk_data, char *s, int count);
+void chksum_to_string(char chksum[CHKSUM_CHARS+1], ChksumData chk_data);
+void chksum_reset(ChksumData *chk_data);
+
+// XXH64 content hash (see igc_content_hash_ok())
+extern const char IGC_HASH_TAG[]; // followed by 16 hex digits
+
+struct Xxh64State {
+	UINT64 total;            // bytes hashed
+	UINT64 v[4];             // the four accumulators
+	unsigned char mem[32];   // bytes waiting for a whole 32 byte stripe
+	size_t mem_size;
+};
+
+void xxh64_reset(Xxh64State *s);
+void xxh64_update(Xxh64State *s, const char *buf, size_t count);
+void xxh64_update_text(Xxh64State *s, const char *text);
+UINT64 xxh64_digest(Xxh64State *s);
+UINT64 xxh64(const char *buf, size_t count);
+bool igc_content_hash_ok(char *filepath);
+
+//*******************************************************************************
+//********************** IGC FILE CHECKSUM **************************************
+//*******************************************************************************
+
+// IgcReader reads an IGC file a line at a time for the parsers (load_igc_file() and
+// menu_tracklog()) and checksums the lines as they go, so the G record is checked in
+// the same pass. igc_reader_close() gives the CHKSUM_RESULT once all the lines have
+// been read.
+struct IgcReader {
+	FileReader file;
+	ChksumData chk_data;
+	bool g_found; // the G record has been read (lines after it aren't checksummed)
+	char g_record[MAXBUF];
+};
+
+CHKSUM_RESULT chksum_igc_g_record(char chksum[CHKSUM_CHARS+1], ChksumData chk_data, char *line_buf);
+CHKSUM_RESULT chksum_igc_file(char chksum[CHKSUM_CHARS+1], char *filepath);
+bool igc_reader_open(IgcReader *r, wchar_t *filepath);
+bool igc_reader_open(IgcReader *r, char *filepath);
+bool igc_reader_line(IgcReader *r, char *line_buf, int max);
+bool igc_reader_next(IgcReader *r, const char **line, size_t *length);
+CHKSUM_RESULT igc_reader_close(IgcReader *r);
+CHKSUM_RESULT check_file(char *pfilepath);
+
+// 'sim_logger verify ...' (argv after "verify"), see chksum.cpp
+int verify_main(int argc, char* argv[]);
+
+#endif
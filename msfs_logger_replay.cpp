@@ -12,6 +12,7 @@
 #include <tchar.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <strsafe.h>
 #include <math.h>
 #include <time.h>
@@ -19,15 +20,48 @@
 #include <sys/timeb.h>
 #include <io.h>
 #include <shlobj.h>
+#include <tmmintrin.h> // SSSE3 intrinsics
+#include <immintrin.h> // AVX-512 VBMI intrinsics
+#include <process.h>   // _beginthreadex
+#include <psapi.h>     // GetProcessMemoryInfo (replay arena debug, 'sim_logger bench io')
+#pragma comment(lib, "psapi.lib")
 
+#include "chksum.h" // checksums, FileReader, verify (chksum.cpp)
 #include "SimConnect.h"
 
 // sim_logger version 
-double version = 2.31;
+double version = 2.32;
 
 //********************************************************************************
 //********************   VERSION HISTORY          ********************************
 //********************************************************************************
+// 2.32  * table-driven checksum (chksum_block), 'bench' command line mode
+//       * SSSE3 checksum engine chosen at startup by CPUID
+//       * large files checksummed on multiple threads (chksum_parallel)
+//       * FLT/WX/CMX/XML/CumulusX.exe checksummed in the background on flight load
+//       * CumulusX.exe checksum cached in Modules\sim_logger\chksum_cache.txt
+//       * B record text and checksum made as each point is logged
+//       * files read through FileReader (memory-mapped), 'bench io' mode
+//       * 'verify' command line mode checks batches of IGC files (CSV/JSON report)
+//       * replay and tracklog menu check the G record while reading the file
+//       * replay_verified_only ini setting
+//       * XXH64 content hash L record, 'verify fast' mode
+//       * IGC B records decoded by column (igc_decode_b), 'bench igc' mode
+//       * SSSE3 decoding of runs of B records on replay load
+//       * ENL, TAS and VAT B record extensions read on replay load, as given by the I record
+//       * IGC header records read in one pass into an IgcHeader (igc_header_line)
+//       * replay points held in an arena sized to the tracklogs loaded, no per-tracklog limit
+//       * replay tracklogs stored as fixed point arrays (ReplayTrack), ~3x smaller
+//       * AI steering in local east/north metres from precomputed segment velocities, 'bench ai' mode
+//       * tracklog pitch/bank/heading from batch (AVX2) haversine legs, 'bench geo' mode
+//       * tracklogs loaded on worker threads, AI objects created as each is ready
+//       * tracklogs only loaded within replay_lookahead of their start, freed once replayed
+//       * AI objects created and removed at their tracklogs' start and end times (ReplayEvent heap)
+//       * update_ai() finds its points from a cursor (replay_find) instead of scanning from the start
+//       * each replay tracklog has a time index (a point for every 8s) for seeks
+//       * AI slew axis events sent once per dispatch pass, unchanged values not resent
+//       * checksum, FileReader and verify code moved to chksum.cpp, which also builds
+//         on Linux as sim_logger_verify
 // 2.31  * bugfix for non-English Flight Simulator X Files
 // 2.30  * uses 'documents\Flight Simulator X Files\sim_connect_unverified_logs
 // 2.29  * looking again at Unicode load of flightplans for plan-G
@@ -80,7 +114,6 @@ bool debug_events = false; // greater level of debug - events
 
 bool menu_show_text = false; // boolean to decide whether to display debug text in FSX window
 
-const int MAXBUF = 1000; // max length of an IGC file line or a filename
 const int MAXC = 20; // max number of C records collectable from PLN file
 const int IGC_TICK_COUNT = 4; // log every 4 seconds
 const INT32 IGC_MAX_RECORDS = 40000; // log a maximum of this many 'B' records.
@@ -92,6 +125,8 @@ const INT32 IGC_MIN_FLIGHT_SECS_TO_LANDING = 80; // don't trigger a log save on
 wchar_t INI_SUB_PATH[] = L"Modules\\sim_logger\\sim_logger.ini";
 // LANG_SUB_PATH has ini_language added plus .ini
 wchar_t LANG_SUB_PATH[] = L"Modules\\sim_logger\\language\\lang_";
+// CumulusX.exe checksum cache (see chksum_cache_lookup())
+wchar_t CHKSUM_CACHE_SUB_PATH[] = L"Modules\\sim_logger\\chksum_cache.txt";
 // default folder for free flight tracklog files
 wchar_t LOG_SUB_PATH[] = L"sim_logger_unverified_logs";
 wchar_t FSXBASE[MAXBUF]; // pathname to FSX base folder (current dir when sim_logger is loaded)
@@ -140,6 +175,8 @@ double ini_pitch_min; // max low-speed pitch in radians (negative)
 double ini_pitch_max; // max high-speed pitch in radians (positive) 
 double ini_pitch_v_zero; // speed in m/s for pitch=0;
 bool ini_enable_autosave;
+bool ini_replay_verified_only; // only replay tracklogs whose G record checks OK
+double ini_replay_lookahead; // seconds before its first point that a tracklog is loaded
 
 // these are the strings used to 'DISABLE' and 'DELETE' tracklogs
 // the string is inserted before the '.igc' e.g. 'myfile[X].igc'
@@ -173,9 +210,6 @@ char xml_name[MAXBUF] = "";
 // directories parsed from file load pathnames
 wchar_t flt_directory[MAXBUF] = L""; 
 
-// length of checksum string
-const int CHKSUM_CHARS = 6;
-
 // printable checksum strings
 char chksum[CHKSUM_CHARS+1]     = "000000";
 char chksum_flt[CHKSUM_CHARS+1] = "000000";
@@ -335,7 +369,6 @@ void clean_string(char *s, wchar_t *in) {
 	s[i] = '\0';
 }
 
-
 //*******************************************************************************
 //****************************  INI FILE ****************************************
 //*******************************************************************************
@@ -481,6 +514,30 @@ void load_ini() {
 	else if (_wcsicmp(buf, L"0")==0) ini_enable_autosave = false;
 	else ini_enable_autosave = true;
 	if (debug) printf("INI: enable_autosave = %s\n", (ini_enable_autosave) ? "true":"false");
+
+	// replay_verified_only
+	length = GetPrivateProfileString(INI_APP_NAME,
+										L"replay_verified_only",
+										ini_default,
+										buf,
+										MAXBUF,
+										ini_path);
+	if (_wcsicmp(buf, L"true")==0) ini_replay_verified_only = true;
+	else if (_wcsicmp(buf, L"1")==0) ini_replay_verified_only = true;
+	else ini_replay_verified_only = false;
+	if (debug) printf("INI: replay_verified_only = %s\n", (ini_replay_verified_only) ? "true":"false");
+
+	// replay_lookahead
+	length = GetPrivateProfileString(INI_APP_NAME,
+										L"replay_lookahead",
+										ini_default,
+										buf,
+										MAXBUF,
+										ini_path);
+	float_buf = 600; // default lookahead = 10 minutes
+	swscanf_s(buf,L"%f",&float_buf);
+	ini_replay_lookahead = max(float_buf, 0);
+	if (debug) printf("INI: replay_lookahead = %.0f s\n", ini_replay_lookahead);
 }
 
 // write or update a key / value pair to the ini file
@@ -610,101 +667,291 @@ bool disable_fsx_thermals() {
 //*******************************************************************************
 //********************** CHECKSUM CALCULATION ***********************************
 //*******************************************************************************
+// The checksum itself and the IGC file checks are in chksum.cpp; here are the
+// checksums of the FSX files for the IGC header.
 
-// return codes from chksum_igc_file()
-static enum CHKSUM_RESULT {
-    CHKSUM_OK,
-	CHKSUM_NOT_FOUND,
-	CHKSUM_TOO_SHORT,
-	CHKSUM_BAD,
-	CHKSUM_FILE_ERROR,
+//*******************************************************************************
+// Checksum cache
+//
+// CumulusX.exe is big and rarely changes but is checksummed on every flight load, so
+// its checksum is kept in CHKSUM_CACHE_SUB_PATH, keyed by the kind of checksum, the
+// file path, size and last write time, and CHKSUM_CACHE_VERSION. A hit needs no read
+// of the file, and any change to its size or write time is a miss. Each line of the
+// cache file starts with a checksum of the rest of the line so damaged lines are
+// ignored. chksum_binary_file() can run on several threads at once, so the cache is
+// guarded by chksum_cache_lock, and chksum_files_wait() saves it once per batch.
+//
+// The cache is no defence against tampering: a file can be edited and its write time
+// set back, and the cache file is the user's to edit (its line checks use the
+// published checksum). So only CumulusX.exe, which only shows the CumulusX version
+// used, is cached. The FLT, WX, CMX, XML, AIR and aircraft.cfg checksums, which show
+// the flight wasn't changed, are always made from the files themselves.
+
+const int CHKSUM_CACHE_VERSION = 2; // change this if the checksum algorithm changes
+                                    // (2: AIR and aircraft.cfg entries no longer used)
+const int CHKSUM_CACHE_MAX = 200;   // max number of files in the cache
+
+// kinds of checksum in the cache
+const char CHKSUM_CACHE_BINARY = 'B'; // chksum_binary_file()
+
+struct ChksumCacheEntry {
+	char kind;             // CHKSUM_CACHE_BINARY etc., 0 if the entry is unused
+	char filepath[MAXBUF];
+	ULONGLONG size;
+	FILETIME mtime;        // last write time
+	char chksum[CHKSUM_CHARS+1];
+	unsigned int last_used; // chksum_cache_clock when last used, for replacing old entries
 };
 
-// number of characters to include in checksum
-const int CHK_CHARS = 63; // number of chars in chk_source and chk_map
-// list of CHK_CHARS characters to be mapped into checksum (other chars ignored)
-char *chk_source = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.abcdefghijklmnopqrstuvwxyz";
-// map table for char->int 0..(CHK_CHARS-1)
-int chk_map[CHK_CHARS]    = { 14,46,51,8,26,2,32,39,29,
-							 37,4,44,20,61,22,58,16,25,
-							 60,13,31,53,11,50,6,38,41,
-							 23,56,17,1,19,45,10,28,15,
-							 36,9,57,12,49,33,3,24,30,
-							 62,47,5,43,0,27,52,34,55,
-							 21,54,59,18,48,35,40,7,42};
-
-// modulo value for chksum_index which increments through the file
-const int CHKSUM_MAX_INDEX = 1987;
-
-struct ChksumData {
-	int index;
-	int num[CHKSUM_CHARS];
-};
+ChksumCacheEntry chksum_cache[CHKSUM_CACHE_MAX];
+bool chksum_cache_loaded = false;
+bool chksum_cache_changed = false; // chksum_cache[] needs saving
+unsigned int chksum_cache_clock = 0;
+int chksum_cache_hits = 0;
+int chksum_cache_misses = 0;
+CRITICAL_SECTION chksum_cache_lock;
+
+// called once at startup
+void chksum_cache_init() {
+	InitializeCriticalSection(&chksum_cache_lock);
+}
 
-// incrementally update checksum given current char c
-void incr_chksum(ChksumData *chk_data, char c) {
-	unsigned int c_pos = 0;
-	// convert c to int via chk_source array
-	while (c_pos<CHK_CHARS && chk_source[c_pos]!=c) c_pos++;
-	// if c not found then simply return (only need checksum valid chars)
-	if (c_pos==CHK_CHARS) return;
+void chksum_cache_path(wchar_t *path, wchar_t *suffix) {
+	wcscpy_s(path, MAXBUF, FSXBASE);
+	wcscat_s(path, MAXBUF, CHKSUM_CACHE_SUB_PATH);
+	wcscat_s(path, MAXBUF, suffix);
+}
 
-	// now c_pos is index of c in char_source, get mapped number
-	int map_num = chk_map[(c_pos + chk_data->index) % CHK_CHARS];
-	for (int i=0; i<CHKSUM_CHARS; i++) {
-		chk_data->num[i] = chk_map[(chk_data->num[i]+map_num+i) % CHK_CHARS];
+// check of one cache file line (without the check itself)
+void chksum_cache_check(char check[CHKSUM_CHARS+1], char *s) {
+	ChksumData chk_data;
+	chksum_reset(&chk_data);
+	chksum_string(&chk_data, s);
+	chksum_to_string(check, chk_data);
+	check[CHKSUM_CHARS] = '\0';
+}
+
+// read the cache file into chksum_cache[]
+void chksum_cache_load() {
+	wchar_t path[MAXBUF];
+	char line_buf[MAXBUF+100];
+	FileReader r;
+	int count = 0;
+
+	chksum_cache_loaded = true;
+	chksum_cache_path(path, L"");
+	if (!file_open(&r, path)) return;
+	while (count<CHKSUM_CACHE_MAX && file_read_line(&r, line_buf, sizeof(line_buf))) {
+		char check[CHKSUM_CHARS+1];
+		char line_check[CHKSUM_CHARS+1];
+		int version, n;
+		unsigned long mtime_high, mtime_low;
+		ChksumCacheEntry *entry = &chksum_cache[count];
+
+		line_buf[strcspn(line_buf, "\r\n")] = '\0';
+		if (strlen(line_buf)<CHKSUM_CHARS+1 || line_buf[CHKSUM_CHARS]!=' ') continue;
+		strncpy_s(line_check, line_buf, CHKSUM_CHARS);
+		chksum_cache_check(check, line_buf+CHKSUM_CHARS+1);
+		if (strcmp(check, line_check)!=0) continue;
+		if (sscanf_s(line_buf+CHKSUM_CHARS+1, "%d %c %I64u %lx %lx %6s %n",
+					&version, &entry->kind, 1, &entry->size, &mtime_high, &mtime_low,
+					entry->chksum, CHKSUM_CHARS+1, &n) != 6) continue;
+		if (version!=CHKSUM_CACHE_VERSION) continue;
+		entry->mtime.dwHighDateTime = mtime_high;
+		entry->mtime.dwLowDateTime = mtime_low;
+		strcpy_s(entry->filepath, MAXBUF, line_buf+CHKSUM_CHARS+1+n);
+		entry->last_used = 0;
+		count++;
 	}
-	// Increment checksum_index
-	chk_data->index = (chk_data->index + 1) % CHKSUM_MAX_INDEX;
+	file_close(&r);
+	// clear any entry left half-read by a bad line
+	for (int i=count; i<CHKSUM_CACHE_MAX; i++) chksum_cache[i].kind = 0;
+	if (debug) printf("Checksum cache: loaded %d entries\n", count);
 }
 
-// update chksum_num based on input string s
-void chksum_string(ChksumData *chk_data, char *s) {
-	for (unsigned int i=0; i<strlen(s); i++) 
-		incr_chksum(chk_data, s[i]);
+// write chksum_cache[] to the cache file (via a temporary file, so a crash can't
+// leave it half written)
+void chksum_cache_save() {
+	wchar_t path[MAXBUF];
+	wchar_t tmp_path[MAXBUF];
+	char s[MAXBUF+100];
+	char check[CHKSUM_CHARS+1];
+	FILE *f;
+
+	chksum_cache_path(path, L"");
+	chksum_cache_path(tmp_path, L".tmp");
+	if (_wfopen_s(&f, tmp_path, L"w")!=0) return;
+	for (int i=0; i<CHKSUM_CACHE_MAX; i++) {
+		ChksumCacheEntry *entry = &chksum_cache[i];
+		if (entry->kind==0) continue;
+		sprintf_s(s, sizeof(s), "%d %c %I64u %08lx %08lx %s %s", CHKSUM_CACHE_VERSION, entry->kind,
+					entry->size, entry->mtime.dwHighDateTime, entry->mtime.dwLowDateTime,
+					entry->chksum, entry->filepath);
+		chksum_cache_check(check, s);
+		fprintf(f, "%s %s\n", check, s);
+	}
+	fclose(f);
+	MoveFileExW(tmp_path, path, MOVEFILE_REPLACE_EXISTING);
 }
 
-// update chksum_num based on BINARY input string s
-void chksum_binary(ChksumData *chk_data, char *s, int count) {
-	for (int i=0; i<count; i++) 
-		incr_chksum(chk_data, s[i]);
+// index of the entry for this kind and file in chksum_cache[], or -1
+int chksum_cache_find(char kind, char *filepath) {
+	for (int i=0; i<CHKSUM_CACHE_MAX; i++) {
+		if (chksum_cache[i].kind==kind && _stricmp(chksum_cache[i].filepath, filepath)==0) return i;
+	}
+	return -1;
 }
 
-// convert chk_data.num[] into string chksum
-void chksum_to_string(char chksum[CHKSUM_CHARS+1], ChksumData chk_data) {
-	for (int i=0; i<CHKSUM_CHARS;i++) 
-		chksum[i] = chk_source[chk_data.num[i] % 36];
+// look for the checksum of filepath in the cache. 'key' is set to the file's current
+// size and write time, to be passed to chksum_cache_store() on a miss. Returns true
+// (and sets chksum) on a hit.
+bool chksum_cache_lookup(char kind, char *filepath, ChksumCacheEntry *key, char chksum[CHKSUM_CHARS+1]) {
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+
+	key->kind = 0;
+	if (!GetFileAttributesExA(filepath, GetFileExInfoStandard, &attr)) return false;
+	key->kind = kind;
+	strcpy_s(key->filepath, MAXBUF, filepath);
+	key->size = ((ULONGLONG)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+	key->mtime = attr.ftLastWriteTime;
+
+	EnterCriticalSection(&chksum_cache_lock);
+	if (!chksum_cache_loaded) chksum_cache_load();
+	int i = chksum_cache_find(kind, filepath);
+	bool hit = i>=0 &&
+				chksum_cache[i].size==key->size &&
+				chksum_cache[i].mtime.dwHighDateTime==key->mtime.dwHighDateTime &&
+				chksum_cache[i].mtime.dwLowDateTime==key->mtime.dwLowDateTime;
+	if (hit) {
+		strcpy_s(chksum, CHKSUM_CHARS+1, chksum_cache[i].chksum);
+		chksum_cache[i].last_used = ++chksum_cache_clock;
+		chksum_cache_hits++;
+	}
+	else chksum_cache_misses++;
+	LeaveCriticalSection(&chksum_cache_lock);
+	return hit;
 }
 
-void chksum_reset(ChksumData *chk_data) {
-	chk_data->index = 1;
-	for (int i=0; i<CHKSUM_CHARS;i++) chk_data->num[i]=i;
+// store the checksum for the file in 'key' (from chksum_cache_lookup()), to be saved
+// by chksum_cache_flush()
+void chksum_cache_store(ChksumCacheEntry *key, char chksum[CHKSUM_CHARS+1]) {
+	if (key->kind==0) return;
+	EnterCriticalSection(&chksum_cache_lock);
+	int i = chksum_cache_find(key->kind, key->filepath);
+	if (i<0) {
+		// use an empty entry, or replace the least recently used
+		i = 0;
+		for (int j=0; j<CHKSUM_CACHE_MAX && chksum_cache[i].kind!=0; j++)
+			if (chksum_cache[j].kind==0 || chksum_cache[j].last_used<chksum_cache[i].last_used) i = j;
+	}
+	chksum_cache[i] = *key;
+	strncpy_s(chksum_cache[i].chksum, chksum, CHKSUM_CHARS);
+	chksum_cache[i].last_used = ++chksum_cache_clock;
+	chksum_cache_changed = true;
+	LeaveCriticalSection(&chksum_cache_lock);
 }
 
-CHKSUM_RESULT chksum_binary_file(char chksum[CHKSUM_CHARS+1], char *filepath) {
-	FILE *f;
-	errno_t err;
-	char buf[MAXBUF];
-	int read_count; // number of chars read
+// save the cache file if chksum_cache_store() has changed it
+void chksum_cache_flush() {
+	EnterCriticalSection(&chksum_cache_lock);
+	if (chksum_cache_changed) chksum_cache_save();
+	chksum_cache_changed = false;
+	LeaveCriticalSection(&chksum_cache_lock);
+}
+
+void chksum_cache_debug() {
+	if (debug) printf("Checksum cache: %d hits, %d misses\n", chksum_cache_hits, chksum_cache_misses);
+}
+
+// checksum of the whole file, from the checksum cache if 'cached' (see above)
+CHKSUM_RESULT chksum_binary_file(char chksum[CHKSUM_CHARS+1], char *filepath, bool cached = false) {
+	FileReader r;
+	const char *data;
+	size_t count;
 	// calculated checksum as sequence of ints 0..CHK_CHARS
 	ChksumData chk_data;
-	
+	ChksumCacheEntry cache_key;
+
+	cache_key.kind = 0;
+	if (cached && chksum_cache_lookup(CHKSUM_CACHE_BINARY, filepath, &cache_key, chksum)) return CHKSUM_OK;
 	chksum_reset(&chk_data);
 
-	if( (err = fopen_s(&f, filepath, "rb")) != 0 ) {
+	if (!file_open(&r, filepath)) {
         strcpy_s(chksum, CHKSUM_CHARS+1, "000000");
 		return CHKSUM_FILE_ERROR;
 	}
-	while (!feof(f)) {
-		read_count = fread(buf, sizeof(char),sizeof(buf),f);
-		chksum_binary(&chk_data, buf, read_count);
-	}
+	// (a mapped file is one block, which chksum_buffer() can split across threads)
+	while (file_read_block(&r, &data, &count)) chksum_buffer(&chk_data, data, count);
 	chksum_to_string(chksum, chk_data);
-	fclose(f);
+	file_close(&r);
+	chksum_cache_store(&cache_key, chksum);
 	return CHKSUM_OK;
 }
 
-CHKSUM_RESULT chksum_cumulusx_exe() {
+//*******************************************************************************
+// Background file checksums
+//
+// process_flt_load_msg() checksums the FLT, WX, CMX, XML and CumulusX.exe files on
+// their own threads, so the SimConnect dispatch loop (AI updates, logging) keeps
+// running meanwhile. chksum_files_wait() must be called before the results are used
+// or the chksum_xxx strings are changed.
+
+const int CHKSUM_MAX_JOBS = 8;
+
+struct ChksumJob {
+	char *chksum;          // where the result goes, e.g. chksum_flt
+	char filepath[MAXBUF];
+	bool cached;           // use the checksum cache
+	CHKSUM_RESULT result;
+	double seconds;        // time taken by chksum_binary_file()
+	HANDLE thread;
+};
+
+ChksumJob chksum_jobs[CHKSUM_MAX_JOBS];
+int chksum_job_count = 0;
+
+unsigned __stdcall chksum_job_thread(void *arg) {
+	ChksumJob *job = (ChksumJob *)arg;
+	double t = perf_seconds();
+	job->result = chksum_binary_file(job->chksum, job->filepath, job->cached);
+	job->seconds = perf_seconds() - t;
+	return 0;
+}
+
+// wait for all the background checksums to finish
+void chksum_files_wait() {
+	if (chksum_job_count==0) return;
+	double t = perf_seconds();
+	for (int i=0; i<chksum_job_count; i++) {
+		ChksumJob *job = &chksum_jobs[i];
+		if (job->thread!=0) {
+			WaitForSingleObject(job->thread, INFINITE);
+			CloseHandle(job->thread);
+		}
+		if (debug) printf("Checksum %s %6.1f ms %s%s\n", job->chksum, job->seconds*1000,
+							job->filepath, job->result==CHKSUM_OK ? "" : " (not found)");
+	}
+	if (debug) printf("Waited %.1f ms for checksums\n", (perf_seconds()-t)*1000);
+	chksum_cache_flush();
+	chksum_cache_debug();
+	chksum_job_count = 0;
+}
+
+// start checksumming filepath into chksum on its own thread
+void chksum_file_start(char chksum[CHKSUM_CHARS+1], char *filepath, bool cached = false) {
+	if (chksum_job_count==CHKSUM_MAX_JOBS) chksum_files_wait();
+	ChksumJob *job = &chksum_jobs[chksum_job_count++];
+	job->chksum = chksum;
+	strcpy_s(job->filepath, MAXBUF, filepath);
+	job->cached = cached;
+	job->result = CHKSUM_FILE_ERROR;
+	job->seconds = 0;
+	job->thread = (HANDLE)_beginthreadex(NULL, 0, chksum_job_thread, job, 0, NULL);
+	if (job->thread==0) chksum_job_thread(job); // couldn't start a thread so do it now
+}
+
+// start the checksum of CumulusX.exe into chksum_cx
+void chksum_cumulusx_exe() {
     wchar_t CX_SUB_PATH[] = L"\\Modules\\CumulusX!\\CumulusX.exe";
     wchar_t cx_path[MAXBUF];
     char buf[MAXBUF];
@@ -713,7 +960,7 @@ CHKSUM_RESULT chksum_cumulusx_exe() {
 	wcscat_s(cx_path, MAXBUF, CX_SUB_PATH);
     clean_string(buf, cx_path);
     if (debug) printf("Finding checksum for %s\n", buf);
-    return chksum_binary_file(chksum_cx, buf);
+    chksum_file_start(chksum_cx, buf, true);
 }
 
 // starts_bracket returns -1 if string doesn't have '[' as first non-space char
@@ -778,21 +1025,20 @@ bool perf_match(char *line_buf) {
 // chksum_cfg_file calculates a checksum for aircraft.cfg file only including sections
 // of the file that affect performance
 CHKSUM_RESULT chksum_cfg_file(char chksum[CHKSUM_CHARS+1], char *filepath) {
-	FILE *f;
-	errno_t err;
+	FileReader r;
 	char line_buf[MAXBUF];
     bool in_perf_section = false;
 
 	// calculated checksum as sequence of ints 0..CHK_CHARS
 	ChksumData chk_data;
-	
+
 	chksum_reset(&chk_data);
 
-	if( (err = fopen_s(&f, filepath, "r")) != 0 ) {
+	if (!file_open(&r, filepath)) {
         strcpy_s(chksum, CHKSUM_CHARS+1, "000000");
 		return CHKSUM_FILE_ERROR;
 	}
-    while (fgets(line_buf, MAXBUF, f)!=NULL) {
+    while (file_read_line(&r, line_buf, MAXBUF)) {
         //debug
         //if (in_perf_section) printf("    PERF ");
         //else printf("NON-PERF ");
@@ -805,55 +1051,10 @@ CHKSUM_RESULT chksum_cfg_file(char chksum[CHKSUM_CHARS+1], char *filepath) {
         }
     }
 	chksum_to_string(chksum, chk_data);
-	fclose(f);
-	return CHKSUM_OK;
-}
-
-// This routine is used to *check* the checksum at the end of an IGC file
-// the checksum will be stored in the final 'G' record.
-// Only alphanumeric characters before the 'G' record contribute to the checksum.
-CHKSUM_RESULT chksum_igc_file(char chksum[CHKSUM_CHARS+1], char *filepath) {
-	FILE *f;
-	errno_t err;
-	char line_buf[MAXBUF];
-	// calculated checksum as sequence of ints 0..CHK_CHARS
-	ChksumData chk_data;
-	
-	chksum_reset(&chk_data);
-
-    // open file
-	if( (err = fopen_s(&f, filepath, "r")) != 0 ) {
-		return CHKSUM_FILE_ERROR;
-	}
-	while (fgets(line_buf, MAXBUF, f)!=NULL) {
-		if (line_buf[0]=='G') break;
-		//if (strncmp(line_buf,"L FSX GENERAL", 13)==0) printf("%s",line_buf+6);
-		chksum_string(&chk_data, line_buf);
-	}
-    // close file
-   	fclose(f);
-
-	if (line_buf[0]!='G') {
-			return CHKSUM_NOT_FOUND;
-	}
-
-	if (strlen(line_buf)<CHKSUM_CHARS+1) {
-			return CHKSUM_TOO_SHORT;
-	}
-	chksum_to_string(chksum, chk_data);
-	for (int i=0; i<CHKSUM_CHARS; i++) {
-		if (chksum[i]!=line_buf[i+1]) {
-			return CHKSUM_BAD;
-		}
-	}
+	file_close(&r);
 	return CHKSUM_OK;
 }
 
-CHKSUM_RESULT check_file(char *pfilepath) {
-	char chksum[CHKSUM_CHARS+1] = "000000";
-	return chksum_igc_file(chksum, pfilepath);
-}
-
 // this routine produces a general checksum for the
 // FLT, WX, CMX, AIR, aircraft.cfg files
 // so if this is correct the user does not have to look at the 
@@ -1158,6 +1359,8 @@ INT32 igc_prev_on_ground = 0;
 // flag to confirm a user file save - so we don't auto-save over it
 bool igc_saved = false;
 
+const int IGC_B_TEXT_SIZE = 64; // room for a 'B' record line with any values
+
 // struct of data in an IGC 'B' record
 struct igc_b {
 	INT32 zulu_time;
@@ -1165,11 +1368,25 @@ struct igc_b {
 	double longitude;
 	double altitude;
     double rpm;
+	char text[IGC_B_TEXT_SIZE]; // the 'B' record line, made by igc_log_point()
 };
 
 // array to hold all the 'B' records
 igc_b igc_pos[IGC_MAX_RECORDS];
 
+// The 'B' records' part of the G record checksum is kept up to date as each point is
+// logged, so igc_write_file() only has to checksum the header. igc_body_table is
+// the B records' effect on the checksum lanes, starting from the checksum index the
+// header is expected to end on (igc_body_index, from the header as it would be when
+// the first point is logged). That only changes if the header gains or loses
+// checksummed chars before the file is written, in which case igc_write_file()
+// checksums the B record text instead.
+ChksumTable igc_body_table;
+int igc_body_index = 0;
+
+// hash of the IGC file as igc_write_file() writes it (see 'Content hash')
+Xxh64State igc_file_hash;
+
 //**********************************************************************************
 //**********************************************************************************
 //******* IGC FILE ROUTINES                                                 ********
@@ -1223,6 +1440,224 @@ void get_user_pos_updates() {
     if (debug_calls) printf(" ..leaving get_user_pos_updates()..\n");
 }
 
+// add a line to the IGC file, its checksum and hash (f==NULL: the checksum only)
+void igc_put_line(FILE *f, ChksumData *chk_data, char *s) {
+	chksum_string(chk_data, s);
+	if (f==NULL) return;
+	fputs(s, f);
+	xxh64_update_text(&igc_file_hash, s);
+}
+
+// write the IGC file header (A, H, I, C and L records). predict: just work out the
+// checksum (f==NULL) without waiting for the background file checksums, which may
+// still be running. Every checksum is CHKSUM_CHARS valid chars, so a placeholder
+// moves the checksum index on the same, and chksum_all is left as it is.
+void igc_write_header(FILE *f, ChksumData *chk_data, bool predict = false) {
+	char s[MAXBUF]; // buffer to how igc records before writing to file
+	char s2[MAXBUF]; // another general text buffer
+	const char placeholder[CHKSUM_CHARS+1] = "000000";
+	const char *flt = predict ? placeholder : chksum_flt;
+	const char *wx = predict ? placeholder : chksum_wx;
+	const char *cmx = predict ? placeholder : chksum_cmx;
+	const char *cx = predict ? placeholder : chksum_cx;
+	const char *xml = predict ? placeholder : chksum_xml;
+
+	// path_to_name(flt_name, flt_pathname); done on FLT load event
+	// path_to_name(wx_name, wx_pathname); done on FLT load
+	path_to_name(air_name, air_pathname);
+	path_to_name(pln_name, pln_pathname);
+	path_to_name(cmx_name, cmx_pathname);
+	path_to_name(cfg_name, cfg_pathname);
+	path_to_name(xml_name, xml_pathname);
+
+	sprintf_s(s,MAXBUF,         "AXXX sim_logger v%.2f\n", version); // manufacturer
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,		   "HFDTE%02.2d%02.2d%02.2d\n", startup_data.zulu_day,     // date
+													startup_data.zulu_month,
+													startup_data.zulu_year % 1000);
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFFXA035\n");                        // gps accuracy
+	igc_put_line(f, chk_data, s);
+
+	strcpy_s(s, MAXBUF, "HFPLTPILOTINCHARGE: ");
+	if (wcscmp(ini_pilot_name, L"")==0) {
+		strcat_s(s,MAXBUF, "pilot ");
+		strcat_s(s,MAXBUF, ATC_ID);
+	} else {
+		clean_string(s2, ini_pilot_name);
+		strcat_s(s,MAXBUF, s2);
+	}
+	strcat_s(s,MAXBUF, "\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFCM2CREW2: not recorded\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFGTYGLIDERTYPE:%s\n", TITLE);
+	igc_put_line(f, chk_data, s);
+
+	strcpy_s(s, MAXBUF, "HFGIDGLIDERID:");
+	if (wcscmp(ini_aircraft_id, L"")==0) {
+		strcat_s(s,MAXBUF, ATC_ID);
+	} else {
+		clean_string(s2, ini_aircraft_id);
+		strcat_s(s,MAXBUF, s2);
+	}
+	strcat_s(s,MAXBUF, "\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFDTM100GPSDATUM: WGS-1984\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFRFWFIRMWAREVERSION: %.2f\n", version);
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFRHWHARDWAREVERSION: 2009\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFFTYFRTYPE: sim_logger by Ian Forster-Lewis\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFGPSGPS:Microsoft Flight Simulator\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFPRSPRESSALTSENSOR: Microsoft Flight Simulator\n");
+	igc_put_line(f, chk_data, s);
+
+	strcpy_s(s, MAXBUF, "HFCIDCOMPETITIONID:");
+	if (wcscmp(ini_aircraft_id, L"")==0) {
+		strcat_s(s,MAXBUF, ATC_ID);
+	} else {
+		clean_string(s2, ini_aircraft_id);
+		strcat_s(s,MAXBUF, s2);
+	}
+	strcat_s(s,MAXBUF, "\n");
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,         "HFCCLCOMPETITIONCLASS: %s\n", ATC_TYPE);
+	igc_put_line(f, chk_data, s);
+
+						// extension record to say info at end of 'B' recs
+						// FXA = fix accuracy
+						// SIU = satellites in use
+						// ENL = engine noise level 000-999
+	sprintf_s(s,MAXBUF,         "I023638FXA3941ENL\n"); 
+	igc_put_line(f, chk_data, s);
+
+	// Task (C) records
+	if (c_wp_count>1) {
+		igc_put_line(f, chk_data, c[0]);
+		igc_put_line(f, chk_data, c[1]);
+		for (int i=0; i<c_wp_count; i++) {
+			igc_put_line(f, chk_data, c[i+2]);
+		}
+		igc_put_line(f, chk_data, c_landing);
+	}
+
+	// FSX Comment (L) records
+    clean_string(s2, flt_start_time);
+    sprintf_s(s,MAXBUF,		   "L FSX user PC time            %s\n", s2);
+	igc_put_line(f, chk_data, s);
+
+    sprintf_s(s,MAXBUF,		   "L FSX FLT checksum            %s (%s)\n", flt, flt_name);
+	igc_put_line(f, chk_data, s);
+
+	//sprintf_s(s,MAXBUF,		   "L FSX PLN filename %s\n", pln_pathname);
+	//igc_put_line(f, chk_data, s);
+	//sprintf_s(s,MAXBUF,		   "L FSX PLN checksum %s\n", chksum_pln);
+	//igc_put_line(f, chk_data, s);
+
+	//sprintf_s(s,MAXBUF,		   "L FSX WX filename %s\n", wx_pathname);
+	//igc_put_line(f, chk_data, s);
+	sprintf_s(s,MAXBUF,		   "L FSX WX checksum             %s (%s)\n", wx, wx_name);
+	igc_put_line(f, chk_data, s);
+
+	//sprintf_s(s,MAXBUF,		   "L FSX CMX filename %s\n", cmx_pathname);
+	//igc_put_line(f, chk_data, s);
+	sprintf_s(s,MAXBUF,		   "L FSX CMX checksum            %s (%s)\n", cmx, cmx_name);
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,		   "L FSX CumulusX.exe checksum   %s\n", cx);
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,		   "L FSX mission checksum        %s (%s)\n", xml, xml_name);
+	igc_put_line(f, chk_data, s);
+
+	sprintf_s(s,MAXBUF,		   "L FSX aircraft.cfg checksum   %s (%s)\n", chksum_cfg, cfg_name);
+	igc_put_line(f, chk_data, s);
+
+	//sprintf_s(s,MAXBUF,		   "L FSX AIR filename %s\n", air_pathname);
+	//igc_put_line(f, chk_data, s);
+	sprintf_s(s,MAXBUF,		   "L FSX AIR checksum            %s (%s)\n", chksum_air, air_name);
+	igc_put_line(f, chk_data, s);
+
+	// write CumulusX status locked/unlocked
+	if (cx_code==0)
+		sprintf_s(s,MAXBUF,		   "L FSX CumulusX status:        UNLOCKED\n");
+	else
+		sprintf_s(s,MAXBUF,		   "L FSX CumulusX status:        LOCKED OK\n");
+	igc_put_line(f, chk_data, s);
+
+	// write wx status (unlocked if user has entered weather menu
+	// after a WX file load
+	if (wx_code==0)
+        sprintf_s(s,MAXBUF,		   "L FSX WX status:              UNLOCKED\n");
+	else
+        sprintf_s(s,MAXBUF,		   "L FSX WX status:              LOCKED OK\n");
+	igc_put_line(f, chk_data, s);
+
+	// ThermalDescriptions.xml entry
+	if (fsx_thermals_enabled)
+		sprintf_s(s,MAXBUF,		   "L FSX ThermalDescriptions.xml STILL BEING USED\n");
+	else
+		sprintf_s(s,MAXBUF,		   "L FSX ThermalDescriptions.xml REMOVED OK\n");
+	igc_put_line(f, chk_data, s);
+
+	// now calculate a value for the GENERAL CHECKSUM
+	if (!predict) chksum_chksum(chksum_all);
+	sprintf_s(s,MAXBUF,		   "L FSX GENERAL CHECKSUM            %s  <---- CHECK THIS FIRST\n",
+			  predict ? placeholder : chksum_all);
+	igc_put_line(f, chk_data, s);
+}
+
+// checksum index at the end of the header, if the file was written now (without
+// waiting for the background checksums, see igc_write_header())
+int igc_header_index() {
+	ChksumData chk_data;
+	chksum_reset(&chk_data);
+	igc_write_header(NULL, &chk_data, true);
+	return chk_data.index;
+}
+
+// make the text of the IGC 'B' record for p
+void igc_b_record(char s[IGC_B_TEXT_SIZE], igc_b *p) {
+	int hours = p->zulu_time / 3600;
+	int minutes = (p->zulu_time - hours * 3600 ) / 60;
+	int secs = p->zulu_time % 60;
+	char NS = (p->latitude>0.0) ? 'N' : 'S';
+	char EW = (p->longitude>0.0) ? 'E' : 'W';
+	double abs_latitude = fabs(p->latitude);
+	double abs_longitude = fabs(p->longitude);
+	int lat_DD = int(abs_latitude);
+	int lat_MM = int( (abs_latitude - float(lat_DD)) * 60.0);
+	int lat_mmm = int( (abs_latitude - float(lat_DD) - (float(lat_MM) / 60.0)) * 60000.0);
+	int long_DDD = int(abs_longitude);
+	int long_MM = int((abs_longitude - float(long_DDD)) * 60.0);
+	int long_mmm = int((abs_longitude - float(long_DDD) - (float(long_MM) / 60.0)) * 60000.0);
+	int altitude = int(p->altitude);
+    int FXA = 27;
+    int ENL = (int(p->rpm)>9990)? 999 : int(p->rpm) / 10;
+
+//			sprintf_s(s,MAXBUF,     "B %02.2d %02.2d %02.2d %02.2d %02.2d %03.3d %c %03.3d %02.2d %03.3d %c A %05.5d %05.5d 000\n",
+	sprintf_s(s,IGC_B_TEXT_SIZE,     "B%02.2d%02.2d%02.2d%02.2d%02.2d%03.3d%c%03.3d%02.2d%03.3d%cA%05.5d%05.5d%03.3d%03.3d\n",
+		    hours, minutes, secs,
+			lat_DD, lat_MM, lat_mmm, NS,
+			long_DDD, long_MM, long_mmm, EW,
+			altitude, altitude, FXA, ENL);
+}
+
 void igc_log_point(UserStruct p) {
 	if (igc_record_count<IGC_MAX_RECORDS) {
 		if (igc_record_count==0 || p.zulu_time!=igc_pos[igc_record_count-1].zulu_time) {
@@ -1231,6 +1666,16 @@ void igc_log_point(UserStruct p) {
 			igc_pos[igc_record_count].altitude = p.altitude;
 			igc_pos[igc_record_count].zulu_time =p.zulu_time;
 			igc_pos[igc_record_count].rpm =p.rpm;
+			igc_b_record(igc_pos[igc_record_count].text, &igc_pos[igc_record_count]);
+			// add the record to the running B record checksum
+			if (igc_record_count==0) {
+				igc_body_index = igc_header_index();
+				chksum_table_reset(&igc_body_table);
+			}
+			chksum_table_extend(&igc_body_table,
+								igc_pos[igc_record_count].text,
+								strlen(igc_pos[igc_record_count].text),
+								(int)((igc_body_index + igc_body_table.valid) % CHKSUM_MAX_INDEX));
 			igc_record_count++;
 		}
 	}
@@ -1274,17 +1719,19 @@ bool free_flight() {
 void igc_write_file(wchar_t *reason) {
 	FILE *f;
 	char buf[MAXBUF];
-	char s[MAXBUF]; // buffer to how igc records before writing to file
+	char hash_record[MAXBUF]; // the content hash L record
 	wchar_t fn[MAXBUF];
 	//wchar_t wflt_pathname[MAXBUF]; // unicode flt_pathname
 	wchar_t wflight_filename[MAXBUF]; // unicode flight_filename
-	char s2[MAXBUF]; // another general text buffer
 	wchar_t ws[MAXBUF]; // general unicode buffer
 	size_t wlen; // length of a wchar buffer
 	errno_t err;
 	ChksumData chk_data;
 	char chksum[CHKSUM_CHARS+1] = "000000";
 
+	// the FLT etc. checksums must be finished before they go in the file
+	chksum_files_wait();
+
     // flag file as saved by user
     if (wcscmp(reason,L"")==0) {
         igc_saved = true;
@@ -1305,13 +1752,6 @@ void igc_write_file(wchar_t *reason) {
 		printf("chksum_cfg=%s\n\n", chksum_cfg);
 	}
 
-	// path_to_name(flt_name, flt_pathname); done on FLT load event
-	// path_to_name(wx_name, wx_pathname); done on FLT load
-	path_to_name(air_name, air_pathname);
-	path_to_name(pln_name, pln_pathname);
-	path_to_name(cmx_name, cmx_pathname);
-	path_to_name(cfg_name, cfg_pathname);
-	path_to_name(xml_name, xml_pathname);
     
 	// make wflight_filename[] = the FLT filename without the .FLT
 	// i.e. "c:\abc\def\my flight.FLT" -> "my flight"
@@ -1399,184 +1839,23 @@ void igc_write_file(wchar_t *reason) {
 		return;
 	} else {
 		chksum_reset(&chk_data);
+		xxh64_reset(&igc_file_hash);
 		// ok we've opened the log file - lets write all the data to it
-		sprintf_s(s,MAXBUF,         "AXXX sim_logger v%.2f\n", version); // manufacturer
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,		   "HFDTE%02.2d%02.2d%02.2d\n", startup_data.zulu_day,     // date
-														startup_data.zulu_month,
-														startup_data.zulu_year % 1000);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFFXA035\n");                        // gps accuracy
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		strcpy_s(s, MAXBUF, "HFPLTPILOTINCHARGE: ");
-		if (wcscmp(ini_pilot_name, L"")==0) {
-			strcat_s(s,MAXBUF, "pilot ");
-			strcat_s(s,MAXBUF, ATC_ID);
-		} else {
-			clean_string(s2, ini_pilot_name);
-			strcat_s(s,MAXBUF, s2);
-		}
-		strcat_s(s,MAXBUF, "\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFCM2CREW2: not recorded\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFGTYGLIDERTYPE:%s\n", TITLE);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		strcpy_s(s, MAXBUF, "HFGIDGLIDERID:");
-		if (wcscmp(ini_aircraft_id, L"")==0) {
-			strcat_s(s,MAXBUF, ATC_ID);
-		} else {
-			clean_string(s2, ini_aircraft_id);
-			strcat_s(s,MAXBUF, s2);
-		}
-		strcat_s(s,MAXBUF, "\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFDTM100GPSDATUM: WGS-1984\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFRFWFIRMWAREVERSION: %.2f\n", version);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFRHWHARDWAREVERSION: 2009\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
+		igc_write_header(f, &chk_data);
 
-		sprintf_s(s,MAXBUF,         "HFFTYFRTYPE: sim_logger by Ian Forster-Lewis\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFGPSGPS:Microsoft Flight Simulator\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFPRSPRESSALTSENSOR: Microsoft Flight Simulator\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		strcpy_s(s, MAXBUF, "HFCIDCOMPETITIONID:");
-		if (wcscmp(ini_aircraft_id, L"")==0) {
-			strcat_s(s,MAXBUF, ATC_ID);
-		} else {
-			clean_string(s2, ini_aircraft_id);
-			strcat_s(s,MAXBUF, s2);
-		}
-		strcat_s(s,MAXBUF, "\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,         "HFCCLCOMPETITIONCLASS: %s\n", ATC_TYPE);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-							// extension record to say info at end of 'B' recs
-							// FXA = fix accuracy
-							// SIU = satellites in use
-							// ENL = engine noise level 000-999
-		sprintf_s(s,MAXBUF,         "I023638FXA3941ENL\n"); 
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		// Task (C) records
-		if (c_wp_count>1) {
-			chksum_string(&chk_data, c[0]); fprintf(f, c[0]);
-			chksum_string(&chk_data, c[1]); fprintf(f, c[1]);
-			for (int i=0; i<c_wp_count; i++) {
-				chksum_string(&chk_data, c[i+2]); fprintf(f, c[i+2]);
-			}
-			chksum_string(&chk_data, c_landing); fprintf(f, c_landing);
-		}
-
-		// FSX Comment (L) records
-        clean_string(s2, flt_start_time);
-        sprintf_s(s,MAXBUF,		   "L FSX user PC time            %s\n", s2);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-        sprintf_s(s,MAXBUF,		   "L FSX FLT checksum            %s (%s)\n", chksum_flt, flt_name);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		//sprintf_s(s,MAXBUF,		   "L FSX PLN filename %s\n", pln_pathname);
-		//chksum_string(&chk_data, s); fprintf(f, s);
-		//sprintf_s(s,MAXBUF,		   "L FSX PLN checksum %s\n", chksum_pln);
-		//chksum_string(&chk_data, s); fprintf(f, s);
-
-		//sprintf_s(s,MAXBUF,		   "L FSX WX filename %s\n", wx_pathname);
-		//chksum_string(&chk_data, s); fprintf(f, s);
-		sprintf_s(s,MAXBUF,		   "L FSX WX checksum             %s (%s)\n", chksum_wx, wx_name);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		//sprintf_s(s,MAXBUF,		   "L FSX CMX filename %s\n", cmx_pathname);
-		//chksum_string(&chk_data, s); fprintf(f, s);
-		sprintf_s(s,MAXBUF,		   "L FSX CMX checksum            %s (%s)\n", chksum_cmx, cmx_name);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,		   "L FSX CumulusX.exe checksum   %s\n", chksum_cx);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,		   "L FSX mission checksum        %s (%s)\n", chksum_xml, xml_name);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		sprintf_s(s,MAXBUF,		   "L FSX aircraft.cfg checksum   %s (%s)\n", chksum_cfg, cfg_name);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		//sprintf_s(s,MAXBUF,		   "L FSX AIR filename %s\n", air_pathname);
-		//chksum_string(&chk_data, s); fprintf(f, s);
-		sprintf_s(s,MAXBUF,		   "L FSX AIR checksum            %s (%s)\n", chksum_air, air_name);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		// write CumulusX status locked/unlocked
-		if (cx_code==0)
-			sprintf_s(s,MAXBUF,		   "L FSX CumulusX status:        UNLOCKED\n");
-		else
-			sprintf_s(s,MAXBUF,		   "L FSX CumulusX status:        LOCKED OK\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		// write wx status (unlocked if user has entered weather menu
-		// after a WX file load
-		if (wx_code==0)
-            sprintf_s(s,MAXBUF,		   "L FSX WX status:              UNLOCKED\n");
-		else
-            sprintf_s(s,MAXBUF,		   "L FSX WX status:              LOCKED OK\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		// ThermalDescriptions.xml entry
-		if (fsx_thermals_enabled)
-			sprintf_s(s,MAXBUF,		   "L FSX ThermalDescriptions.xml STILL BEING USED\n");
-		else
-			sprintf_s(s,MAXBUF,		   "L FSX ThermalDescriptions.xml REMOVED OK\n");
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		// now calculate a value for the GENERAL CHECKSUM
-		chksum_chksum(chksum_all);
-		sprintf_s(s,MAXBUF,		   "L FSX GENERAL CHECKSUM            %s  <---- CHECK THIS FIRST\n", chksum_all);
-		chksum_string(&chk_data, s); fprintf(f, s);
-
-		// now do the 'B' location records
+		// now do the 'B' location records, precomputed by igc_log_point()
+		bool body_ok = igc_record_count>0 && chk_data.index==igc_body_index;
+		if (debug) printf("B records checksum %s (header index %d, predicted %d)\n",
+							body_ok ? "precomputed" : "recalculated", chk_data.index, igc_body_index);
+		if (body_ok) chksum_table_apply(&chk_data, &igc_body_table);
 		for (INT32 i=0; i<igc_record_count; i++) {
-			int hours = igc_pos[i].zulu_time / 3600;
-			int minutes = (igc_pos[i].zulu_time - hours * 3600 ) / 60;
-			int secs = igc_pos[i].zulu_time % 60;
-			char NS = (igc_pos[i].latitude>0.0) ? 'N' : 'S';
-			char EW = (igc_pos[i].longitude>0.0) ? 'E' : 'W';
-			double abs_latitude = fabs(igc_pos[i].latitude);
-			double abs_longitude = fabs(igc_pos[i].longitude);
-			int lat_DD = int(abs_latitude);
-			int lat_MM = int( (abs_latitude - float(lat_DD)) * 60.0);
-			int lat_mmm = int( (abs_latitude - float(lat_DD) - (float(lat_MM) / 60.0)) * 60000.0);
-			int long_DDD = int(abs_longitude);
-			int long_MM = int((abs_longitude - float(long_DDD)) * 60.0);
-			int long_mmm = int((abs_longitude - float(long_DDD) - (float(long_MM) / 60.0)) * 60000.0);
-			int altitude = int(igc_pos[i].altitude);
-            int FXA = 27;
-            int ENL = (int(igc_pos[i].rpm)>9990)? 999 : int(igc_pos[i].rpm) / 10;
-
-//			sprintf_s(s,MAXBUF,     "B %02.2d %02.2d %02.2d %02.2d %02.2d %03.3d %c %03.3d %02.2d %03.3d %c A %05.5d %05.5d 000\n",
-			sprintf_s(s,MAXBUF,     "B%02.2d%02.2d%02.2d%02.2d%02.2d%03.3d%c%03.3d%02.2d%03.3d%cA%05.5d%05.5d%03.3d%03.3d\n",
-				    hours, minutes, secs,
-					lat_DD, lat_MM, lat_mmm, NS,
-					long_DDD, long_MM, long_mmm, EW,
-					altitude, altitude, FXA, ENL);
-			chksum_string(&chk_data, s); fprintf(f, s);
+			if (!body_ok) chksum_string(&chk_data, igc_pos[i].text);
+			fputs(igc_pos[i].text, f);
+			xxh64_update_text(&igc_file_hash, igc_pos[i].text);
 		}
+		// hash of everything written so far, covered by the G record
+		sprintf_s(hash_record, MAXBUF, "%s%016I64X\n", IGC_HASH_TAG, xxh64_digest(&igc_file_hash));
+		chksum_string(&chk_data, hash_record); fputs(hash_record, f);
 		chksum_to_string(chksum, chk_data);
 		fprintf(f,         "G%s\n",chksum);
 
@@ -1638,6 +1917,10 @@ void igc_ground_check(INT32 on_ground, INT32 zulu_time) {
 //*******************************************************************************
 //*******************************************************************************
 
+const double M_PI = 4.0*atan(1.0); // pi
+const double EARTH_RAD = 6366710.0; // earth's radius in meters
+const double METRES_PER_DEGREE = EARTH_RAD * M_PI / 180.0; // of latitude (of longitude at the equator)
+
 //*******************************************************************************
 // AI DATA
 const int MAX_AI = 200;
@@ -1650,6 +1933,16 @@ int ai_retry_count = 0;
 bool ai_failed = false; // flag set to true when any object create fail detected
 int ai_count = 0; // count of IGC files loaded
 
+// values of the B record extensions used in replay (0 if the tracklog doesn't
+// have them, see AIInfo.ext_fields)
+struct IgcExt {
+	INT32 enl;     // engine noise level 0-999
+	double tas;    // true airspeed, meters per second
+	double vario;  // compensated (total energy) vario, meters per second
+};
+
+const IgcExt igc_ext_none = { 0, 0.0, 0.0 };
+
 struct ReplayPoint {
     double latitude;  // (PLANE LATITUDE, degrees) north positive
     double longitude; // (PLANE LONGITUDE, degrees) east positive
@@ -1659,6 +1952,7 @@ struct ReplayPoint {
 	double heading;   // (PLANE HEADING DEGREES TRUE, radians)
 	INT32 zulu_time;   // (ZULU TIME, seconds) seconds since midnight UTC 
 	double speed;     // forward speed, meters per second
+	IgcExt ext;       // ENL, TAS, vario from the B record
 };
 
 // block of data locating ai object
@@ -1688,8 +1982,360 @@ struct AiSetDataStruct {
 	char atc_id[32];
 };
 
+// A loaded tracklog, packed by replay_pack() from the ReplayPoints made by
+// load_igc_file() into one fixed point array per value, so scanning the times in
+// update_ai() touches 4 bytes a point rather than a whole ReplayPoint. Read it with
+// the replay_ accessors below. Scales and worst case errors (from rounding):
+//   latitude, longitude   1e-7 degree       5.6mm (IGC B records are to ~1.85m)
+//   altitude              0.5m              0.25m (INT16: +/-16383m)
+//   pitch, bank           pi/32768 radian   0.003 degree (0.006 next to +pi)
+//   heading, course       2pi/65536 radian  0.003 degree (0 to 2pi)
+//   velocity, tas         0.01 m/s          0.005 m/s (velocity +/-327 m/s, tas max 655 m/s)
+//   vario                 0.01 m/s          0.005 m/s
+//   zulu time and ENL are exact.
+// The ENL/TAS/vario arrays are NULL if the tracklog has none of them (ext_fields 0).
+//
+// index[k] is the first point at index_time + k*REPLAY_INDEX_STEP or after, so the
+// point for any time is found from the few points in one step (replay_seek()).
+// index_time is the first point's time, and the last entry is for the last point's.
+//
+// The velocity and course of each segment (point i to i+1, 0 for the last point)
+// are worked out once by replay_pack(), in metres east and north of point i (the
+// local tangent plane there, see EnuFrame), so update_ai() can steer with a few
+// multiply-adds instead of bearing() and distance(). A frame per segment rather
+// than one per tracklog keeps the bearings true: over a cross-country flight one
+// tangent plane's north drifts by degrees from the local north FSX headings use.
+struct ReplayTrack {
+	INT32 *time;      // zulu time, seconds
+	INT32 *latitude;  // 1e-7 degrees
+	INT32 *longitude; // 1e-7 degrees
+	INT32 *index;     // index_count points, see above
+	INT16 *altitude;  // 0.5 m
+	INT16 *pitch;     // pi/32768 radians
+	INT16 *bank;      // pi/32768 radians
+	UINT16 *heading;  // 2pi/65536 radians
+	INT16 *east_velocity;  // 0.01 m/s, of segment i to i+1
+	INT16 *north_velocity; // 0.01 m/s
+	UINT16 *course;   // bearing of segment i to i+1, 2pi/65536 radians
+	INT16 *enl;
+	UINT16 *tas;      // 0.01 m/s
+	INT16 *vario;     // 0.01 m/s
+	INT32 index_time;
+	int index_count;
+};
+
+const int REPLAY_INDEX_STEP = 8;              // seconds between ReplayTrack.index entries
+const double REPLAY_DEGREE = 1e7;             // ReplayTrack latitude/longitude units per degree
+const double REPLAY_METRE = 2;                // altitude units per metre
+const double REPLAY_RADIAN = 32768 / M_PI;    // pitch/bank/heading units per radian
+const double REPLAY_SPEED = 100;              // velocity/tas/vario units per m/s
+
 // here's the structure that holds the replay records for all loaded flights
-ReplayPoint replay[MAX_AI][IGC_MAX_RECORDS];
+// (the arrays are in the replay arena)
+ReplayTrack replay[MAX_AI];
+
+inline INT32 replay_time(const ReplayTrack *r, int i) { return r->time[i]; }
+inline double replay_latitude(const ReplayTrack *r, int i) { return r->latitude[i] / REPLAY_DEGREE; }
+inline double replay_longitude(const ReplayTrack *r, int i) { return r->longitude[i] / REPLAY_DEGREE; }
+inline double replay_altitude(const ReplayTrack *r, int i) { return r->altitude[i] / REPLAY_METRE; }
+inline double replay_pitch(const ReplayTrack *r, int i) { return r->pitch[i] / REPLAY_RADIAN; }
+inline double replay_bank(const ReplayTrack *r, int i) { return r->bank[i] / REPLAY_RADIAN; }
+inline double replay_heading(const ReplayTrack *r, int i) { return r->heading[i] / REPLAY_RADIAN; }
+inline double replay_east_velocity(const ReplayTrack *r, int i) { return r->east_velocity[i] / REPLAY_SPEED; }
+inline double replay_north_velocity(const ReplayTrack *r, int i) { return r->north_velocity[i] / REPLAY_SPEED; }
+inline double replay_course(const ReplayTrack *r, int i) { return r->course[i] / REPLAY_RADIAN; }
+
+// ground speed arriving at point i (as ai_update_pbhs() sets ReplayPoint.speed)
+inline double replay_speed(const ReplayTrack *r, int i) {
+	if (i==0) return 0;
+	return sqrt(replay_east_velocity(r, i-1) * replay_east_velocity(r, i-1) +
+				replay_north_velocity(r, i-1) * replay_north_velocity(r, i-1));
+}
+
+// the first point of a tracklog of count points with a time of t or after, count if
+// there isn't one. Looked up in its index, then a binary search of the points in
+// that step.
+int replay_seek(const ReplayTrack *r, int count, double t) {
+	if (count==0 || t<=r->index_time) return 0;
+	// index[k] is before t, index[k+1] (or count) is t or after
+	int k = (int)ceil((t - r->index_time) / REPLAY_INDEX_STEP) - 1;
+	int a = r->index[min(k, r->index_count-1)] - 1;
+	int b = (k+1<r->index_count) ? r->index[k+1] : count;
+	while (b-a>1) {
+		int m = (a+b)/2;
+		if (replay_time(r, m)<t) a = m;
+		else b = m;
+	}
+	return b;
+}
+
+// the first point from 1 to count-3 of a tracklog of count points with a time of t
+// or after, count-2 if there isn't one (as update_ai() has always searched). hint is
+// the point found last time: time only moves on a second or so between calls, so
+// it's usually that or the next point. Otherwise (a warp or a jump back in time)
+// it's looked up with replay_seek().
+int replay_find(const ReplayTrack *r, int count, double t, int hint) {
+	int hi = count-2;
+	if (hi<=1) return hi;
+	if (hint>=1 && hint<hi && replay_time(r, hint)>=t && (hint==1 || replay_time(r, hint-1)<t))
+		return hint;
+	if (hint>=1 && hint+1<hi && replay_time(r, hint)<t && replay_time(r, hint+1)>=t)
+		return hint+1;
+	return max(1, min(replay_seek(r, count, t), hi));
+}
+
+// The local tangent plane at a point of a tracklog: metres east/north of the point
+// are degrees of longitude/latitude from it times east_scale/METRES_PER_DEGREE.
+// Kept for each AI object (in AIInfo) so the cos() is only done when the point
+// it's steering from changes.
+struct EnuFrame {
+	int point;         // -1 if not set
+	double east_scale; // metres per degree of longitude at the point
+};
+
+inline double enu_east_scale(EnuFrame *f, const ReplayTrack *r, int i) {
+	if (f->point!=i) {
+		f->point = i;
+		f->east_scale = METRES_PER_DEGREE * cos(replay_latitude(r, i) * (M_PI / 180.0));
+	}
+	return f->east_scale;
+}
+
+// point i of the tracklog, as a ReplayPoint
+ReplayPoint replay_point(const ReplayTrack *r, int i) {
+	ReplayPoint p;
+	p.zulu_time = replay_time(r, i);
+	p.latitude = replay_latitude(r, i);
+	p.longitude = replay_longitude(r, i);
+	p.altitude = replay_altitude(r, i);
+	p.pitch = replay_pitch(r, i);
+	p.bank = replay_bank(r, i);
+	p.heading = replay_heading(r, i);
+	p.speed = replay_speed(r, i);
+	p.ext = igc_ext_none;
+	if (r->enl!=NULL) {
+		p.ext.enl = r->enl[i];
+		p.ext.tas = r->tas[i] / REPLAY_SPEED;
+		p.ext.vario = r->vario[i] / REPLAY_SPEED;
+	}
+	return p;
+}
+
+//*******************************************************************************
+// Replay arena
+//
+// The tracklogs of a flight are packed one after another into one reserved range
+// of address space, with pages committed as they are added. So only the memory the
+// tracklogs need is used, and reset_ai() frees them all with one decommit (the
+// whole pages of each tracklog are decommitted as soon as it has been replayed). Each
+// replay loader thread reads its tracklog into a scratch arena of its own, where it
+// can grow in place with no limit on its points (other than the whole arena), and
+// copies it to replay_arena once it is packed.
+
+const size_t REPLAY_ARENA_RESERVE = 512*1024*1024; // address space reserved (halved until it can be)
+const size_t REPLAY_SCRATCH_RESERVE = 64*1024*1024; // for each loader thread
+const size_t REPLAY_ARENA_RESERVE_MIN = 16*1024*1024;
+const size_t REPLAY_ARENA_COMMIT = 1024*1024;      // pages are committed this many bytes at a time
+const size_t REPLAY_ARENA_PAGE = 4096;             // replay_arena_free_track() decommits whole pages
+
+struct ReplayArena {
+	char *base;       // reserved range, NULL until the first tracklog is loaded
+	size_t reserved;  // bytes reserved at base
+	size_t committed; // bytes committed at base
+	size_t used;      // bytes used by the tracklogs loaded so far
+	size_t reserve;   // bytes to reserve
+};
+
+ReplayArena replay_arena = { NULL, 0, 0, 0, REPLAY_ARENA_RESERVE };
+CRITICAL_SECTION replay_arena_lock; // for the loader threads adding to replay_arena
+
+// resident memory of this process in MB, for the debug output
+double replay_arena_working_set() {
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+	return pmc.WorkingSetSize / (1024.0*1024.0);
+}
+
+// start of the next tracklog's points, NULL if there's no arena
+ReplayPoint *replay_arena_top(ReplayArena *a) {
+	if (a->base==NULL) {
+		for (a->reserved=a->reserve; a->reserved>=REPLAY_ARENA_RESERVE_MIN; a->reserved/=2) {
+			a->base = (char *)VirtualAlloc(NULL, a->reserved, MEM_RESERVE, PAGE_READWRITE);
+			if (a->base!=NULL) break;
+		}
+		if (a->base==NULL) {
+			a->reserved = 0;
+			return NULL;
+		}
+		if (debug && a==&replay_arena) printf("Replay arena: %.0f MB reserved\n", a->reserved / (1024.0*1024.0));
+	}
+	return (ReplayPoint *)(a->base + a->used);
+}
+
+// make sure there's room for bytes from replay_arena_top(), committing more pages
+// if needed. false if the arena is full.
+inline bool replay_arena_fit(ReplayArena *a, size_t bytes) {
+	size_t need = a->used + bytes;
+	if (need<=a->committed) return true;
+	if (need>a->reserved) return false;
+	size_t commit = min(a->reserved, (need + REPLAY_ARENA_COMMIT - 1) / REPLAY_ARENA_COMMIT * REPLAY_ARENA_COMMIT);
+	if (VirtualAlloc(a->base + a->committed, commit - a->committed, MEM_COMMIT, PAGE_READWRITE)==NULL)
+		return false;
+	a->committed = commit;
+	return true;
+}
+
+// the tracklog at replay_arena_top() takes bytes
+void replay_arena_add(ReplayArena *a, size_t bytes) {
+	a->used += (bytes + 7) & ~(size_t)7;
+}
+
+// free all the tracklogs' points (keeps the address range for the next flight)
+void replay_arena_reset(ReplayArena *a) {
+	if (a->committed>0) VirtualFree(a->base, a->committed, MEM_DECOMMIT);
+	if (debug && a->committed>0)
+		printf("Replay arena: %.1f MB freed (%.0f MB resident)\n",
+			   a->committed / (1024.0*1024.0), replay_arena_working_set());
+	a->committed = 0;
+	a->used = 0;
+}
+
+// give back the arena's address range
+void replay_arena_release(ReplayArena *a) {
+	if (a->base!=NULL) VirtualFree(a->base, 0, MEM_RELEASE);
+	a->base = NULL;
+	a->reserved = 0;
+	a->committed = 0;
+	a->used = 0;
+}
+
+inline INT32 replay_round(double x) {
+	return (INT32)floor(x + 0.5);
+}
+
+// clamp x to an INT16/UINT16
+inline INT16 replay_int16(double x) {
+	return (INT16)max(-32768, min(32767, replay_round(x)));
+}
+
+inline UINT16 replay_uint16(double x) {
+	return (UINT16)max(0, min(65535, replay_round(x)));
+}
+
+// angle (radians) in 2pi/65536 units, 0 to 2pi
+inline UINT16 replay_angle(double angle) {
+	angle = fmod(angle, 2*M_PI);
+	if (angle<0) angle += 2*M_PI;
+	return (UINT16)(replay_round(angle * REPLAY_RADIAN) & 0xFFFF);
+}
+
+// bytes of the arrays for a ReplayTrack of count points and index_count index entries
+size_t replay_track_bytes(int count, bool ext, int index_count) {
+	return count * (3*sizeof(INT32) + 7*sizeof(INT16) + (ext ? 3*sizeof(INT16) : 0)) +
+		   index_count * sizeof(INT32);
+}
+
+// point the arrays of r at base, for count points and index_count index entries
+void replay_track_arrays(ReplayTrack *r, char *base, int count, bool ext, int index_count) {
+	r->time = (INT32 *)base;
+	r->latitude = r->time + count;
+	r->longitude = r->latitude + count;
+	r->index = r->longitude + count;
+	r->index_count = index_count;
+	r->altitude = (INT16 *)(r->index + index_count);
+	r->pitch = r->altitude + count;
+	r->bank = r->pitch + count;
+	r->heading = (UINT16 *)(r->bank + count);
+	r->east_velocity = (INT16 *)(r->heading + count);
+	r->north_velocity = r->east_velocity + count;
+	r->course = (UINT16 *)(r->north_velocity + count);
+	r->enl = ext ? (INT16 *)(r->course + count) : NULL;
+	r->tas = ext ? (UINT16 *)(r->enl + count) : NULL;
+	r->vario = ext ? (INT16 *)(r->tas + count) : NULL;
+}
+
+// pack the count points at p (at replay_arena_top(a)) into r, in their place in the
+// arena. false if the arena is full.
+bool replay_pack(ReplayArena *a, ReplayTrack *r, ReplayPoint *p, int count, bool ext) {
+	// the arrays are made after the points, then moved down over them
+	size_t points = (count*sizeof(ReplayPoint) + 7) & ~(size_t)7;
+	int index_count = (count>0) ? (p[count-1].zulu_time - p[0].zulu_time) / REPLAY_INDEX_STEP + 1 : 0;
+	if (index_count<1) index_count = 1; // (the last time is before the first past midnight)
+	size_t bytes = replay_track_bytes(count, ext, index_count);
+	if (!replay_arena_fit(a, points + bytes)) return false;
+	ReplayTrack t;
+	replay_track_arrays(&t, (char *)p + points, count, ext, index_count);
+	t.index_time = (count>0) ? p[0].zulu_time : 0;
+	int j = 0;
+	for (int k=0; k<index_count; k++) {
+		while (j<count && p[j].zulu_time<t.index_time + k*REPLAY_INDEX_STEP) j++;
+		t.index[k] = j;
+	}
+	for (int i=0; i<count; i++) {
+		t.time[i] = p[i].zulu_time;
+		t.latitude[i] = replay_round(p[i].latitude * REPLAY_DEGREE);
+		t.longitude[i] = replay_round(p[i].longitude * REPLAY_DEGREE);
+		t.altitude[i] = replay_int16(p[i].altitude * REPLAY_METRE);
+		t.pitch[i] = replay_int16(p[i].pitch * REPLAY_RADIAN);
+		t.bank[i] = replay_int16(p[i].bank * REPLAY_RADIAN);
+		t.heading[i] = replay_angle(p[i].heading);
+		// segment velocity, in the frame at p[i]
+		double east = 0;
+		double north = 0;
+		if (i+1<count && p[i+1].zulu_time>p[i].zulu_time) {
+			double dt = p[i+1].zulu_time - p[i].zulu_time;
+			double dlon = p[i+1].longitude - p[i].longitude;
+			if (dlon>180) dlon -= 360;
+			else if (dlon<-180) dlon += 360;
+			east = dlon * METRES_PER_DEGREE * cos(p[i].latitude * (M_PI / 180.0)) / dt;
+			north = (p[i+1].latitude - p[i].latitude) * METRES_PER_DEGREE / dt;
+		}
+		t.east_velocity[i] = replay_int16(east * REPLAY_SPEED);
+		t.north_velocity[i] = replay_int16(north * REPLAY_SPEED);
+		t.course[i] = replay_angle(atan2(east, north));
+		if (ext) {
+			t.enl[i] = (INT16)p[i].ext.enl;
+			t.tas[i] = replay_uint16(p[i].ext.tas * REPLAY_SPEED);
+			t.vario[i] = replay_int16(p[i].ext.vario * REPLAY_SPEED);
+		}
+	}
+	memmove(p, t.time, bytes);
+	replay_track_arrays(r, (char *)p, count, ext, index_count);
+	r->index_time = t.index_time;
+	replay_arena_add(a, bytes);
+	return true;
+}
+
+// copy the count points of r (packed in a loader thread's scratch arena) to the end
+// of replay_arena, and point r at them there. false if replay_arena is full.
+bool replay_arena_copy(ReplayTrack *r, int count, bool ext) {
+	size_t bytes = replay_track_bytes(count, ext, r->index_count);
+	EnterCriticalSection(&replay_arena_lock);
+	char *base = (char *)replay_arena_top(&replay_arena);
+	bool ok = base!=NULL && replay_arena_fit(&replay_arena, bytes);
+	if (ok) replay_arena_add(&replay_arena, bytes);
+	LeaveCriticalSection(&replay_arena_lock);
+	if (!ok) return false;
+	memcpy(base, r->time, bytes);
+	replay_track_arrays(r, base, count, ext, r->index_count);
+	return true;
+}
+
+// decommit the pages of a tracklog in replay_arena that has been replayed. Only the
+// pages wholly inside it are freed (the ones at its ends are shared with the
+// tracklogs beside it, until replay_arena_reset()). Returns the bytes freed.
+size_t replay_arena_free_track(ReplayTrack *r, int count, bool ext) {
+	if (r->time==NULL) return 0;
+	size_t start = (char *)r->time - replay_arena.base;
+	size_t end = start + replay_track_bytes(count, ext, r->index_count);
+	start = (start + REPLAY_ARENA_PAGE - 1) / REPLAY_ARENA_PAGE * REPLAY_ARENA_PAGE;
+	end = end / REPLAY_ARENA_PAGE * REPLAY_ARENA_PAGE;
+	if (end<=start) return 0;
+	VirtualFree(replay_arena.base + start, end - start, MEM_DECOMMIT);
+	return end - start;
+}
+
+const int AI_AXES = 5; // slew axis rates update_ai() sets (see ai_control())
 
 struct AIInfo {
     int logpoint_count; // count of logpoints in this tracklog
@@ -1700,6 +2346,15 @@ struct AIInfo {
     bool default_tried; // set to true when a create with default a/c has been tried
 	char title[MAXBUF];
 	char atc_id[MAXBUF];
+	CHKSUM_RESULT chksum_result; // G record check of the tracklog
+	EnuFrame frame; // tangent plane update_ai() last steered in
+	int ext_fields; // IGC_EXT_ flags of the ReplayPoint.ext values the tracklog has
+	DWORD axis_rate[AI_AXES]; // slew axis rates from update_ai(), for ai_control_flush()
+	DWORD axis_sent[AI_AXES]; // the rates FSX was last sent
+	bool axis_valid;    // axis_sent is what FSX has (false after a MOVE or slew on/off)
+	bool axis_pending;  // axis_rate is to be sent (dropped by a MOVE or slew on/off)
+	bool axis_queued;   // in ai_control_queue[]
+	double axis_time;   // perf_seconds() when all the rates were last sent
 	INT32 gear_up_disable_timeout; // zulu time after which we can raise the gear
 	bool gear_up; // gear up status
     bool slew_on; // slew status (used for gear animations)
@@ -1709,13 +2364,163 @@ struct AIInfo {
 
 AIInfo ai_info[MAX_AI];
 
-char *ai_model="DG808S"; // sim_logger SimProbe or DG808S ...
-
+// The replay loader: load_igc_files() finds the tracklogs of a flight and starts
+// threads that igc_scan_file() each one, which just reads its header and the times
+// of its first and last points. replay_load_poll() (on the dispatch thread) then
+// watches zulu_clock, and as each tracklog's start comes within ini_replay_lookahead
+// it's handed back to the threads to load_igc_file() (open, parse and interpolate
+// the B records, work out the pitch/bank/heading, pack it into replay_arena). Once
+// that's done all that's left for the dispatch thread is to create_ai() it
+// REPLAY_CREATE_AHEAD before its first point, and to remove it and free its points
+// at its last. Tracklogs that end before zulu_clock are never loaded at all.
+//
+// So replay_load_poll() doesn't look at every tracklog each time round the dispatch
+// loop, the threads pass back the loads they've finished in a list (done), and the
+// times the dispatch thread is waiting for are kept in a min-heap (events). Each
+// load has at most one event at a time: WAITING for its lookahead, READY for its
+// AI object to be created, or REPLAYING until its end.
+
+// what the loader has done with a tracklog (ReplayLoad.state)
+const LONG REPLAY_LOAD_FOUND = 0;     // to be scanned
+const LONG REPLAY_LOAD_SCANNING = 1;
+const LONG REPLAY_LOAD_WAITING = 2;   // scanned, start not within the lookahead yet
+const LONG REPLAY_LOAD_DUE = 3;       // to be loaded
+const LONG REPLAY_LOAD_LOADING = 4;
+const LONG REPLAY_LOAD_READY = 5;     // loaded, for replay_load_poll() to create_ai()
+const LONG REPLAY_LOAD_REPLAYING = 6; // ai_info[ai_index]
+const LONG REPLAY_LOAD_DONE = 7;      // replayed (or ended before zulu_clock), points freed
+const LONG REPLAY_LOAD_FAILED = 8;    // not to be replayed
+
+const double REPLAY_CREATE_AHEAD = 60; // seconds before its first point that an AI object is created
+
+// a zulu time replay_load_poll() is waiting for
+struct ReplayEvent {
+	double time;
+	int load;             // index in replay_loader.loads
+};
+
+// a tracklog for the loader threads
+struct ReplayLoad {
+	wchar_t path[MAXBUF];
+	volatile LONG state;  // REPLAY_LOAD_...
+	INT32 start_time;     // zulu time of its first and last points, from igc_scan_file()
+	INT32 end_time;       // (before start_time if it goes past midnight)
+	AIInfo info;          // ai_info[] entry for it (title and atc_id from the scan until loaded)
+	ReplayTrack track;    // its points, in replay_arena
+	int ai_index;         // once it's replaying
+	double t_scan;        // seconds taken by igc_scan_file()
+	double t_open;        // seconds taken by each stage of load_igc_file()
+	double t_parse;
+	double t_kinematics;
+	double t_pack;
+	double t_done;        // perf_seconds() when it was loaded
+};
+
+struct ReplayLoader {
+	ReplayLoad *loads;    // the tracklogs found (malloc'd, NULL when not loading)
+	int count;
+	int scanned;          // count of loads scanned
+	int finished;         // count of loads DONE or FAILED
+	ReplayEvent *events;  // min-heap on time (malloc'd, room for count)
+	int event_count;
+	int *done;            // loads the threads have finished scanning or loading (malloc'd, room for count)
+	volatile int done_count;
+	int *taken;           // the done list as replay_load_poll() takes it
+	CRITICAL_SECTION done_lock;
+	HANDLE work;          // semaphore, released once for each load to scan or load
+	volatile LONG cancel; // set to stop the threads after the loads they're doing
+	HANDLE threads[CHKSUM_MAX_THREADS];
+	int thread_count;
+	ReplayArena scratch;  // for loading on the dispatch thread, if no threads could be started
+	double t_start;       // perf_seconds() at the start of load_igc_files()
+	double t_find;        // seconds taken finding the files
+	double t_wait;        // seconds between loads being done and picked up
+	double t_create;      // seconds taken by create_ai()
+	size_t freed;         // bytes of replay_arena freed after replay
+	double working_set;   // resident MB at the start
+};
+
+ReplayLoader replay_loader;
+
+void replay_load_init() {
+	InitializeCriticalSection(&replay_arena_lock);
+	memset(&replay_loader, 0, sizeof(replay_loader));
+	InitializeCriticalSection(&replay_loader.done_lock);
+	replay_loader.scratch.reserve = REPLAY_SCRATCH_RESERVE;
+}
+
+// stop the loader threads (after the tracklogs they're loading) and drop the loads
+// not replayed yet
+void replay_load_stop() {
+	ReplayLoader *l = &replay_loader;
+	InterlockedExchange(&l->cancel, 1);
+	if (l->thread_count>0) ReleaseSemaphore(l->work, l->thread_count, NULL);
+	for (int i=0; i<l->thread_count; i++) {
+		WaitForSingleObject(l->threads[i], INFINITE);
+		CloseHandle(l->threads[i]);
+	}
+	l->thread_count = 0;
+	if (l->work!=NULL) CloseHandle(l->work);
+	l->work = NULL;
+	replay_arena_release(&l->scratch);
+	free(l->loads);
+	free(l->events);
+	free(l->done);
+	free(l->taken);
+	l->loads = NULL;
+	l->events = NULL;
+	l->done = NULL;
+	l->taken = NULL;
+	l->count = 0;
+	l->scanned = 0;
+	l->finished = 0;
+	l->event_count = 0;
+	l->done_count = 0;
+}
+
+// add an event to the heap
+void replay_event_push(ReplayLoader *l, double time, int load) {
+	int i = l->event_count++;
+	while (i>0 && l->events[(i-1)/2].time>time) {
+		l->events[i] = l->events[(i-1)/2];
+		i = (i-1)/2;
+	}
+	l->events[i].time = time;
+	l->events[i].load = load;
+}
+
+// take the earliest event off the heap (event_count>0)
+ReplayEvent replay_event_pop(ReplayLoader *l) {
+	ReplayEvent top = l->events[0];
+	ReplayEvent last = l->events[--l->event_count];
+	int i = 0;
+	for (;;) {
+		int c = 2*i+1;
+		if (c>=l->event_count) break;
+		if (c+1<l->event_count && l->events[c+1].time<l->events[c].time) c++;
+		if (last.time<=l->events[c].time) break;
+		l->events[i] = l->events[c];
+		i = c;
+	}
+	if (l->event_count>0) l->events[i] = last;
+	return top;
+}
+
+// (loader thread) hand load i back to replay_load_poll()
+void replay_load_done(ReplayLoader *l, int i) {
+	EnterCriticalSection(&l->done_lock);
+	l->done[l->done_count++] = i;
+	LeaveCriticalSection(&l->done_lock);
+}
+
+char *ai_model="DG808S"; // sim_logger SimProbe or DG808S ...
+
 // flag to suppress PROBE ID exceptions (missing probe errors) while probes are re-created
 
 bool suppress_object_id_exceptions = false;
 
 double zulu_clock = 0.0; // this is sim_logger's version of FSX 'ZULU TIME'
+bool zulu_clock_synced = false; // zulu_clock has been synced since the flight was loaded
 double zulu_offset = 0.0; // zulu_time is system_time+zulu_offset
 
 //debug timer var to reduce update rate
@@ -1729,9 +2534,6 @@ int test_time_offset = 0; // adjustment (s) to time on file load for testing
 // END OF AI DATA
 //*******************************************************************************
 
-const double M_PI = 4.0*atan(1.0); // pi
-const double EARTH_RAD = 6366710.0; // earth's radius in meters
-
 //**********************************************************************************
 // now we have a number of functions to do lat/long calculations to work
 // out the lat/long needed for each probe.
@@ -1800,6 +2602,161 @@ double target_heading(double lat1, double lon1, double lat2, double lon2, double
     return bearing(avg_lat1, avg_lon1, avg_lat2, avg_lon2);
 }
 
+//**********************************************************************************
+// Batch geodesy: the distance and bearing of each leg between a run of points, as
+// ai_update_pbhs() needs for a whole tracklog. The distance is by the haversine
+// formula, on the same sphere as distance() but without its acos() losing precision
+// on legs of a few metres, and the north part of the bearing is sin(dlat) plus a
+// small term rather than the difference of two nearly equal products. sin/cos of
+// each point's latitude is worked out once for the legs either side of it, and
+// sin(dlon), cos(dlon) and sin(dlat) come from the sin/cos of the half angles the
+// haversine needs anyway.
+//
+// Against Vincenty's formulae on the WGS84 ellipsoid ('sim_logger bench geo') the
+// sphere is out by up to 0.5% in distance and 0.2 degrees in bearing, for legs of
+// 1m to 1000km (distance() is out by 1% on the shortest, from the acos()).
+// geo_legs_avx2() agrees with geo_legs_scalar() to about 1e-13: over 100000 random
+// legs, from near-zero to near-antipodal, the biggest differences measured were
+// 8.2e-14 (relative) in distance and 1.2e-13 radians in bearing, on the longest legs.
+
+// distance (m) and bearing (radians, 0..2pi) of the count-1 legs from point k to
+// k+1 (lat[], lon[] in degrees) into dist[k], bearing[k]
+void geo_legs_scalar(const double *lat, const double *lon, int count, double *dist, double *bearing) {
+	if (count<2) return;
+	double sin_lat1 = sin(deg2rad(lat[0]));
+	double cos_lat1 = cos(deg2rad(lat[0]));
+	for (int k=0; k+1<count; k++) {
+		double sin_lat2 = sin(deg2rad(lat[k+1]));
+		double cos_lat2 = cos(deg2rad(lat[k+1]));
+		// (the differences are taken in degrees, where they're exact)
+		double half_dlat = deg2rad(lat[k+1] - lat[k]) / 2;
+		double half_dlon = deg2rad(lon[k+1] - lon[k]) / 2;
+		double sin_hlat = sin(half_dlat);
+		double sin_hlon = sin(half_dlon);
+		double cos_hlon = cos(half_dlon);
+		double a = min(sin_hlat*sin_hlat + cos_lat1*cos_lat2*sin_hlon*sin_hlon, 1.0);
+		dist[k] = 2 * atan2(sqrt(a), sqrt(1-a)) * EARTH_RAD;
+		double y = 2*sin_hlon*cos_hlon * cos_lat2;
+		double x = 2*sin_hlat*cos(half_dlat) + 2*sin_lat1*cos_lat2*sin_hlon*sin_hlon;
+		double b = atan2(y, x);
+		bearing[k] = (b<0) ? b + 2*M_PI : b;
+		sin_lat1 = sin_lat2;
+		cos_lat1 = cos_lat2;
+	}
+}
+
+// sin and cos of 4 angles (radians, up to a few thousand): reduced to +-pi/4 by
+// the nearest multiple of pi/2 (in three parts, as Cody & Waite) then the Cephes
+// polynomials, good to ~1 ulp
+inline void geo_sincos_avx2(__m256d x, __m256d *sin_x, __m256d *cos_x) {
+	__m256d j = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(0.63661977236758134308)),
+								_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256d r = _mm256_sub_pd(x, _mm256_mul_pd(j, _mm256_set1_pd(1.57079625129699707031)));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(j, _mm256_set1_pd(7.54978941586159635336E-8)));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(j, _mm256_set1_pd(5.39030285815811905290E-15)));
+	__m256d z = _mm256_mul_pd(r, r);
+	__m256d ps = _mm256_set1_pd(1.58962301576546568060E-10);
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-2.50507477628578072866E-8));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(2.75573136213857245213E-6));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-1.98412698295895385996E-4));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(8.33333333332211858878E-3));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-1.66666666666666307295E-1));
+	__m256d s = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, z), ps));
+	__m256d pc = _mm256_set1_pd(-1.13585365213876817300E-11);
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(2.08757008419747316778E-9));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(-2.75573141792967388112E-7));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(2.48015872888517045348E-5));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(-1.38888888888730564116E-3));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(4.16666666666665929218E-2));
+	__m256d c = _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(z, _mm256_set1_pd(0.5))),
+							  _mm256_mul_pd(_mm256_mul_pd(z, z), pc));
+	// quadrant q: odd swaps sin and cos, sin is negated in 2,3 and cos in 1,2
+	__m256i q = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(j));
+	__m256d swap = _mm256_castsi256_pd(_mm256_slli_epi64(q, 63));
+	__m256d sign = _mm256_set1_pd(-0.0);
+	__m256d sin_sign = _mm256_and_pd(_mm256_castsi256_pd(_mm256_slli_epi64(q, 62)), sign);
+	__m256d cos_sign = _mm256_and_pd(_mm256_castsi256_pd(
+							_mm256_slli_epi64(_mm256_add_epi64(q, _mm256_set1_epi64x(1)), 62)), sign);
+	*sin_x = _mm256_xor_pd(_mm256_blendv_pd(s, c, swap), sin_sign);
+	*cos_x = _mm256_xor_pd(_mm256_blendv_pd(c, s, swap), cos_sign);
+}
+
+// atan2(y, x) of 4 pairs: atan of min(|x|,|y|)/max(|x|,|y|) (the Cephes rational
+// function, with 0.66..1 moved to -0.2..0 about pi/4) then put in its octant
+inline __m256d geo_atan2_avx2(__m256d y, __m256d x) {
+	__m256d sign = _mm256_set1_pd(-0.0);
+	__m256d one = _mm256_set1_pd(1.0);
+	__m256d ay = _mm256_andnot_pd(sign, y);
+	__m256d ax = _mm256_andnot_pd(sign, x);
+	__m256d swap = _mm256_cmp_pd(ay, ax, _CMP_GT_OQ);
+	__m256d t = _mm256_div_pd(_mm256_min_pd(ay, ax), _mm256_max_pd(_mm256_max_pd(ay, ax), _mm256_set1_pd(1e-300)));
+	__m256d big = _mm256_cmp_pd(t, _mm256_set1_pd(0.66), _CMP_GT_OQ);
+	t = _mm256_blendv_pd(t, _mm256_div_pd(_mm256_sub_pd(t, one), _mm256_add_pd(t, one)), big);
+	__m256d z = _mm256_mul_pd(t, t);
+	__m256d p = _mm256_set1_pd(-8.750608600031904122785E-1);
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(-1.615753718733365076637E1));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(-7.500855792314704667340E1));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(-1.228866684490136173410E2));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(-6.485021904942025371773E1));
+	__m256d q = _mm256_add_pd(z, _mm256_set1_pd(2.485846490142306297962E1));
+	q = _mm256_add_pd(_mm256_mul_pd(q, z), _mm256_set1_pd(1.650270098316988542046E2));
+	q = _mm256_add_pd(_mm256_mul_pd(q, z), _mm256_set1_pd(4.328810604912902668951E2));
+	q = _mm256_add_pd(_mm256_mul_pd(q, z), _mm256_set1_pd(4.853903996359136964868E2));
+	q = _mm256_add_pd(_mm256_mul_pd(q, z), _mm256_set1_pd(1.945506571482613964425E2));
+	__m256d r = _mm256_add_pd(t, _mm256_mul_pd(_mm256_mul_pd(t, z), _mm256_div_pd(p, q)));
+	r = _mm256_add_pd(r, _mm256_and_pd(big, _mm256_set1_pd(7.85398163397448309616E-1 + 3.061616997868383E-17)));
+	r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(1.57079632679489661923), r), swap);
+	r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(3.14159265358979323846), r), x);
+	return _mm256_or_pd(r, _mm256_and_pd(y, sign));
+}
+
+// geo_legs_scalar() 4 legs at a time. The sin/cos of the latitudes at the far end
+// of the legs are those of the near end shifted down one, with the next 4 points'.
+void geo_legs_avx2(const double *lat, const double *lon, int count, double *dist, double *bearing) {
+	const __m256d radians = _mm256_set1_pd(1.74532925199432957692E-2);
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d two = _mm256_set1_pd(2.0);
+	const __m256d one = _mm256_set1_pd(1.0);
+	int k = 0;
+	if (count>=8) {
+		__m256d sin_lat1, cos_lat1;
+		geo_sincos_avx2(_mm256_mul_pd(_mm256_loadu_pd(lat), radians), &sin_lat1, &cos_lat1);
+		for (; k+8<=count; k+=4) {
+			__m256d sin_next, cos_next; // points k+4..k+7
+			geo_sincos_avx2(_mm256_mul_pd(_mm256_loadu_pd(lat+k+4), radians), &sin_next, &cos_next);
+			// [a1 a2 a3 b0] of a, b
+			__m256d sin_lat2 = _mm256_shuffle_pd(sin_lat1, _mm256_permute2f128_pd(sin_lat1, sin_next, 0x21), 5);
+			__m256d cos_lat2 = _mm256_shuffle_pd(cos_lat1, _mm256_permute2f128_pd(cos_lat1, cos_next, 0x21), 5);
+			__m256d sin_hlat, cos_hlat, sin_hlon, cos_hlon;
+			geo_sincos_avx2(_mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(lat+k+1), _mm256_loadu_pd(lat+k)),
+														radians), half), &sin_hlat, &cos_hlat);
+			geo_sincos_avx2(_mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(lon+k+1), _mm256_loadu_pd(lon+k)),
+														radians), half), &sin_hlon, &cos_hlon);
+			__m256d hlon2 = _mm256_mul_pd(sin_hlon, sin_hlon);
+			__m256d a = _mm256_add_pd(_mm256_mul_pd(sin_hlat, sin_hlat),
+									  _mm256_mul_pd(_mm256_mul_pd(cos_lat1, cos_lat2), hlon2));
+			a = _mm256_min_pd(a, one);
+			__m256d d = geo_atan2_avx2(_mm256_sqrt_pd(a), _mm256_sqrt_pd(_mm256_sub_pd(one, a)));
+			_mm256_storeu_pd(dist+k, _mm256_mul_pd(d, _mm256_set1_pd(2*EARTH_RAD)));
+			__m256d y = _mm256_mul_pd(_mm256_mul_pd(two, _mm256_mul_pd(sin_hlon, cos_hlon)), cos_lat2);
+			__m256d x = _mm256_mul_pd(two, _mm256_add_pd(_mm256_mul_pd(sin_hlat, cos_hlat),
+									  _mm256_mul_pd(_mm256_mul_pd(sin_lat1, cos_lat2), hlon2)));
+			__m256d b = geo_atan2_avx2(y, x);
+			b = _mm256_add_pd(b, _mm256_and_pd(_mm256_cmp_pd(b, _mm256_setzero_pd(), _CMP_LT_OQ),
+											   _mm256_set1_pd(2*M_PI)));
+			_mm256_storeu_pd(bearing+k, b);
+			sin_lat1 = sin_next;
+			cos_lat1 = cos_next;
+		}
+	}
+	geo_legs_scalar(lat+k, lon+k, count-k, dist+k, bearing+k);
+}
+
+void geo_legs(const double *lat, const double *lon, int count, double *dist, double *bearing) {
+	if (cpu_avx2) geo_legs_avx2(lat, lon, count, dist, bearing);
+	else geo_legs_scalar(lat, lon, count, dist, bearing);
+}
+
 // +ve/-ve difference between two headings
 double heading_delta(double desired, double current) {
     double angle;
@@ -1813,19 +2770,21 @@ double heading_delta(double desired, double current) {
 
 // distance_and_bearing(...) returns a new lat/long a distance and bearing from lat1,lon1.
 // lat, longs in degrees, rbearng in radians, distance in meters
+// (each sin/cos is taken once, and the longitude change is an atan2() so it needs
+// no special case at the poles)
 ReplayPoint distance_and_bearing(ReplayPoint p, double distance, double rbearing) {
 	double rlat1, rlong1, rdistance, rlat2, rlong2;
 	ReplayPoint r;
 	rlat1 = deg2rad(p.latitude);
 	rlong1 = deg2rad(p.longitude);
 	rdistance = m2rad(distance);
-	rlat2 = asin(sin(rlat1)*cos(rdistance)+cos(rlat1)*sin(rdistance)*cos(rbearing));
-	if (cos(rlat2)==0) {
-        rlong2 = rlong1;      // endpoint a pole
-	}
-	else {
-		rlong2 = fmod((rlong1+asin(sin(rbearing)*sin(rdistance)/cos(rlat2))+M_PI),(2*M_PI))-M_PI;
-	}
+	double sin_lat1 = sin(rlat1);
+	double cos_lat1 = cos(rlat1);
+	double sin_dist = sin(rdistance);
+	double cos_dist = cos(rdistance);
+	double sin_lat2 = sin_lat1*cos_dist + cos_lat1*sin_dist*cos(rbearing);
+	rlat2 = asin(sin_lat2);
+	rlong2 = fmod((rlong1+atan2(sin(rbearing)*sin_dist*cos_lat1, cos_dist-sin_lat1*sin_lat2)+M_PI),(2*M_PI))-M_PI;
 	r.latitude = rad2deg(rlat2);
 	r.longitude = rad2deg(rlong2);
 	return r;
@@ -1862,6 +2821,7 @@ ReplayPoint interp(ReplayPoint p0, ReplayPoint p1, ReplayPoint p2, ReplayPoint p
     ReplayPoint r = distance_and_bearing(p1, distance_to_interp1, new_heading1);
 	r.zulu_time = p1.zulu_time + step_time;
 	r.altitude = p1.altitude + ((double)step_time/(double)time_delta)*(p2.altitude-p1.altitude);
+	r.ext = p1.ext;
 	return r;
 }
 //*********************************************************************************************
@@ -1970,6 +2930,7 @@ void zulu_clock_sync(INT32 zulu_time) {
 		//if (debug) printf("New offset %.2f\n",zulu_offset);
 	}
 	zulu_clock = system_time + zulu_offset;
+	zulu_clock_synced = true;
 }
 
 void remove_ai(int ai_index)
@@ -1983,8 +2944,96 @@ void remove_ai(int ai_index)
 	}
 }
 
+// The five slew axis rates update_ai() works out for an AI object each second are
+// queued by ai_control() and sent by ai_control_flush() at the end of each pass of
+// the dispatch loop. SimConnect has no way to send several events in one call (and
+// the slew rates aren't SimVars SetDataOnSimObject() could set), so what's saved is
+// the rates that haven't changed since they were last sent, e.g. for the gliders
+// sitting on the ground. They're all sent again every AI_CONTROL_REFRESH seconds,
+// and after a MOVE or slew on/off (which also drop the rates queued before them, so
+// they're not sent after it). With debug on, the events sent per dispatch pass
+// are printed every AI_CONTROL_REPORT seconds.
+
+const EVENT_ID ai_axis_event[AI_AXES] = { EVENT_AXIS_SLEW_AHEAD_SET, EVENT_AXIS_SLEW_HEADING_SET,
+										  EVENT_AXIS_SLEW_ALT_SET, EVENT_AXIS_SLEW_BANK_SET,
+										  EVENT_AXIS_SLEW_PITCH_SET };
+const double AI_CONTROL_REFRESH = 10;
+const double AI_CONTROL_REPORT = 60;
+
+int ai_control_queue[MAX_AI]; // AI objects with rates to send
+int ai_control_count = 0;
+
+// message counts since the last report
+int ai_control_ticks = 0;      // dispatch passes with rates to send
+int ai_control_updates = 0;    // AI objects updated
+int ai_control_sent = 0;       // events sent
+int ai_control_unchanged = 0;  // rates not sent
+double ai_control_report = 0;  // perf_seconds() of the last report
+
+// queue the slew axis rates for AI object ai_index (replacing any queued this pass)
+void ai_control(int ai_index, DWORD ahead, DWORD heading, DWORD alt, DWORD bank, DWORD pitch) {
+	AIInfo *info = &ai_info[ai_index];
+	info->axis_rate[0] = ahead;
+	info->axis_rate[1] = heading;
+	info->axis_rate[2] = alt;
+	info->axis_rate[3] = bank;
+	info->axis_rate[4] = pitch;
+	info->axis_pending = true;
+	if (!info->axis_queued) {
+		info->axis_queued = true;
+		ai_control_queue[ai_control_count++] = ai_index;
+	}
+}
+
+// send the queued slew axis rates that have changed
+void ai_control_flush() {
+	HRESULT hr;
+	if (ai_control_count>0) ai_control_ticks++;
+	for (int q=0; q<ai_control_count; q++) {
+		int ai_index = ai_control_queue[q];
+		AIInfo *info = &ai_info[ai_index];
+		info->axis_queued = false;
+		if (!info->axis_pending || !info->created) continue;
+		info->axis_pending = false;
+		// (perf_seconds() as zulu_clock can go back if the sim time is changed)
+		bool refresh = !info->axis_valid || perf_seconds() - info->axis_time >= AI_CONTROL_REFRESH;
+		for (int a=0; a<AI_AXES; a++) {
+			if (!refresh && info->axis_rate[a]==info->axis_sent[a]) {
+				ai_control_unchanged++;
+				continue;
+			}
+			hr = SimConnect_TransmitClientEvent(hSimConnect,
+												info->id,
+												ai_axis_event[a],
+												info->axis_rate[a],
+												SIMCONNECT_GROUP_PRIORITY_HIGHEST,
+												SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+			info->axis_sent[a] = info->axis_rate[a];
+			ai_control_sent++;
+		}
+		if (refresh) {
+			info->axis_valid = true;
+			info->axis_time = perf_seconds();
+		}
+		ai_control_updates++;
+	}
+	ai_control_count = 0;
+
+	if (perf_seconds() - ai_control_report < AI_CONTROL_REPORT) return;
+	if (debug && ai_control_ticks>0)
+		printf("AI control: %.1f AI updates, %.1f slew events per tick (%d%% of the rates unchanged, not sent)\n",
+			   (double)ai_control_updates / ai_control_ticks, (double)ai_control_sent / ai_control_ticks,
+			   100 * ai_control_unchanged / max(1, ai_control_sent + ai_control_unchanged));
+	ai_control_report = perf_seconds();
+	ai_control_ticks = 0;
+	ai_control_updates = 0;
+	ai_control_sent = 0;
+	ai_control_unchanged = 0;
+}
+
 // reset the loaded AI igc files
 void reset_ai() {
+	replay_load_stop();
 	for (int i=0; i<ai_count; i++) {
 		remove_ai(i);
 		ai_info[i].created = false;
@@ -1997,6 +3046,8 @@ void reset_ai() {
 		ai_info[i].slew_on = false;
 	}
 	ai_count = 0;
+	ai_control_count = 0;
+	replay_arena_reset(&replay_arena);
     ai_created_or_failed = 0;
     ai_failed = false;
     ai_retry_count = 0;
@@ -2018,7 +3069,9 @@ void move_ai(int ai_index, ReplayPoint r) {
 										DEFINITION_AI_MOVE,
 										ai_info[ai_index].id,
 										0, 0, sizeof(ai_move_data), &ai_move_data);
-	// send slew command to stop
+	// send slew command to stop (and drop any rates queued before it, which would undo it)
+	ai_info[ai_index].axis_valid = false;
+	ai_info[ai_index].axis_pending = false;
 	hr = SimConnect_TransmitClientEvent(hSimConnect,
 						ai_info[ai_index].id,
 						EVENT_AXIS_SLEW_AHEAD_SET,
@@ -2033,15 +3086,16 @@ void create_ai(int ai_index)
     HRESULT hr;
 
 	SIMCONNECT_DATA_INITPOSITION ai_init;
+	ReplayPoint start = replay_point(&replay[ai_index], 0);
     
-    //ai_init.Altitude   = replay[ai_index][0].altitude;  // Altitude of Sea-tac is 433 feet
+    //ai_init.Altitude   = start.altitude;  // Altitude of Sea-tac is 433 feet
     //debug - added 40 feet for seatac test
-    ai_init.Altitude   = m2ft(replay[ai_index][0].altitude)+10; // feet Altitude of Sea-tac is 433 feet
-    ai_init.Latitude   = replay[ai_index][0].latitude;    // Degrees Convert from 47 25.90 N
-    ai_init.Longitude  = replay[ai_index][0].longitude;   // Degrees Convert from 122 18.48 W
-    ai_init.Pitch      = rad2deg(replay[ai_index][0].pitch);       // Degrees
-    ai_init.Bank       = rad2deg(replay[ai_index][0].bank);        // Degrees
-    ai_init.Heading    = rad2deg(replay[ai_index][0].heading);     // Degrees
+    ai_init.Altitude   = m2ft(start.altitude)+10; // feet Altitude of Sea-tac is 433 feet
+    ai_init.Latitude   = start.latitude;    // Degrees Convert from 47 25.90 N
+    ai_init.Longitude  = start.longitude;   // Degrees Convert from 122 18.48 W
+    ai_init.Pitch      = rad2deg(start.pitch);       // Degrees
+    ai_init.Bank       = rad2deg(start.bank);        // Degrees
+    ai_init.Heading    = rad2deg(start.heading);     // Degrees
     ai_init.OnGround   = 0;                               // 1=OnGround, 0 = airborne
     ai_init.Airspeed   = 0;                               // Knots
     
@@ -2094,6 +3148,8 @@ void ai_set_slew(int ai_index, bool on) {
         (ai_info[ai_index].slew_on) ? "ON" : "OFF",
         (on) ? "ON" : "OFF");
     ai_info[ai_index].slew_on = on;
+    ai_info[ai_index].axis_valid = false;
+    ai_info[ai_index].axis_pending = false; // rates queued before this are out of date
     if (on)
 	    hr = SimConnect_TransmitClientEvent(hSimConnect,
 										ai_info[ai_index].id,
@@ -2154,14 +3210,14 @@ void ai_gear(int ai_index, int current_target, AIStruct pos) {
 	const double LANDING_SPEED = 10; // m/s
 	const INT32 LANDING_LOOKAHEAD = 100; // (seconds) look ahead 2 minutes
 	const double GEAR_UP_HEIGHT = 40; // meters
-	ReplayPoint *r = replay[ai_index];
+	const ReplayTrack *r = &replay[ai_index];
 
-	INT32 current_time = r[current_target].zulu_time;
+	INT32 current_time = replay_time(r, current_target);
 	if (debug) printf("ai_gear(%d) @ %d, gear=%s, speed=%.2f, agl=%.2f timeout=",
 		ai_index,
 		current_time, 
 		(ai_info[ai_index].gear_up)?"UP":"DOWN",
-		(float) r[current_target].speed,
+		(float) replay_speed(r, current_target),
 		(float) pos.altitude_agl
 		);
 	if ( current_time < ai_info[ai_index].gear_up_disable_timeout) {
@@ -2171,10 +3227,11 @@ void ai_gear(int ai_index, int current_target, AIStruct pos) {
 	if (debug) printf("\n");
 
 	int i = current_target;
-	while (ai_info[ai_index].gear_up && 
-				r[i].zulu_time < current_time + LANDING_LOOKAHEAD) {
-		if (debug) printf("%.0f,",r[i].speed);
-		if (r[i].speed < LANDING_SPEED ) {
+	// first point after the lookahead (logpoint_count if there isn't one)
+	int lookahead = replay_seek(r, ai_info[ai_index].logpoint_count, current_time + LANDING_LOOKAHEAD);
+	while (ai_info[ai_index].gear_up && i<lookahead) {
+		if (debug) printf("%.0f,",replay_speed(r, i));
+		if (replay_speed(r, i) < LANDING_SPEED ) {
 			ai_info[ai_index].gear_up = false;
 			ai_info[ai_index].gear_up_disable_timeout = current_time + LANDING_LOOKAHEAD;
 			if (debug) printf(" sending GEAR_DOWN to ai(%d) until %d\n", ai_index, ai_info[ai_index].gear_up_disable_timeout);
@@ -2217,6 +3274,64 @@ void get_ai_pos_updates(int ai_index) {
 											SIMCONNECT_PERIOD_SECOND); 
 }
 
+//*****************************************************************************************
+// steering towards the predict point
+
+struct AiSteer {
+	ReplayPoint predict_point; // altitude, pitch, bank and heading of the predict point
+	double bearing_to_wp;      // radians, from the AI object to the predict point
+	double distance;           // metres from the AI object to the predict point
+	DWORD heading_rate;
+	DWORD ahead_rate;
+	DWORD bank_rate;
+	DWORD pitch_rate;
+	DWORD alt_rate;
+};
+
+// slew rates to get the AI object at pos to the point on tracklog r at predict_time
+// (between points j-1 and j) in period seconds. The sums are done in metres east and
+// north of point j-1 (see EnuFrame), from its segment's precomputed velocity.
+void ai_steer(AiSteer *s, const ReplayTrack *r, EnuFrame *frame, int j, double predict_time,
+			  double period, double alt_offset, AIStruct *pos) {
+	int k = j-1; // the predict point is on the segment from r[k] to r[j]
+	double dt = max(predict_time - replay_time(r, k), 0); // don't extrapolate *before* r[k]
+	// progress is fraction of forward progress beyond found replay point
+	double progress = dt / (replay_time(r, j) - replay_time(r, k));
+
+	// predict point and AI object in metres east/north of r[k]
+	double east_scale = enu_east_scale(frame, r, k);
+	double dlon = pos->longitude - replay_longitude(r, k);
+	if (dlon>180) dlon -= 360;
+	else if (dlon<-180) dlon += 360;
+	double east = dt * replay_east_velocity(r, k) - dlon * east_scale;
+	double north = dt * replay_north_velocity(r, k) - (pos->latitude - replay_latitude(r, k)) * METRES_PER_DEGREE;
+	s->distance = sqrt(east*east + north*north);
+	s->bearing_to_wp = atan2(east, north);
+	if (s->bearing_to_wp<0) s->bearing_to_wp += 2*M_PI;
+
+	// include alt_offset in alt calc
+	s->predict_point.altitude = replay_altitude(r, k) + progress * (replay_altitude(r, j) - replay_altitude(r, k)) + alt_offset;
+	s->predict_point.heading = replay_course(r, k);
+	if (pos->sim_on_ground) {
+		// ON GROUND, so we can calibrate the IGC file alts with an offset
+		// temporarily disabled while I think about the issues...
+		//ai_info[ai_index].alt_offset = pos.altitude - replay_altitude(r, j-1);
+		//if (debug) printf("%s alt_offset %.1f\n",ai_info[ai_index].atc_id, ai_info[ai_index].alt_offset);
+		s->predict_point.pitch = 0;
+		s->predict_point.bank = 0;
+	} else {
+		s->predict_point.bank = replay_bank(r, k) + progress * (replay_bank(r, j) - replay_bank(r, k));
+		s->predict_point.pitch = replay_pitch(r, k) + progress * (replay_pitch(r, j) - replay_pitch(r, k));
+	}
+
+	// now calculate steering deltas based on predict point
+	s->heading_rate = slew_turn_rate(s->bearing_to_wp, pos->heading, s->predict_point.heading);
+	s->ahead_rate = slew_ahead_to_rate(s->distance / period);
+	s->bank_rate = slew_rotation_to_rate((s->predict_point.bank - pos->bank) / period);
+	s->pitch_rate = slew_rotation_to_rate((s->predict_point.pitch - pos->pitch) / period);
+	s->alt_rate = slew_alt_to_rate((pos->altitude - s->predict_point.altitude) / period);
+}
+
 //*****************************************************************************************
 //***********************        update_ai()   ********************************************
 //*****************************************************************************************
@@ -2227,23 +3342,13 @@ void get_ai_pos_updates(int ai_index) {
 void update_ai(int ai_index, AIStruct pos) {
     const double PREDICT_PERIOD = 4; // predict replay position 4 seconds ahead
 	const double AI_WARP_TIME = 30; // if current AI point is 30 seconds old, then MOVE not SLEW
-    HRESULT hr;
-    int i = 1;
-    ReplayPoint *r = replay[ai_index]; // the array of ReplayPoints for current tracklog
-    ReplayPoint predict_point; // a ReplayPoint for the predicted position
-
-    bool found = false;
-    // scan the loaded IGC file until you find current time position
-    //debug - this could be more efficient if we assume monotonic time
-    while (i<ai_info[ai_index].logpoint_count-2) {
-	    if (zulu_clock>r[i].zulu_time) i++;
-	    else {
-		    found = true;
-		    break;
-	    }
-    }
+    const ReplayTrack *r = &replay[ai_index]; // the array of ReplayPoints for current tracklog
+    int count = ai_info[ai_index].logpoint_count;
+
+    // find the current time position, from where it was last time
+    int i = replay_find(r, count, zulu_clock, ai_info[ai_index].next_logpoint);
     // now r[i] is first ReplayPoint AFTER current sim zulu_clock
-	if (!found) {
+	if (i>=count-2) {
 		remove_ai(ai_index);
 		return;
 	}
@@ -2252,10 +3357,10 @@ void update_ai(int ai_index, AIStruct pos) {
 
     }
 	// test to see if zulu_time of current AI position is so old we should MOVE not SLEW
-	if (zulu_clock - r[ai_info[ai_index].next_logpoint].zulu_time > AI_WARP_TIME) {
+	if (zulu_clock - replay_time(r, ai_info[ai_index].next_logpoint) > AI_WARP_TIME) {
 		if (debug) printf("zulu_clock: %.1f, next point: %d(%d), current: %d(%d)\n",
-			zulu_clock, i, r[i].zulu_time, ai_info[ai_index].next_logpoint, r[ai_info[ai_index].next_logpoint].zulu_time);
-		move_ai(ai_index, r[i]);
+			zulu_clock, i, replay_time(r, i), ai_info[ai_index].next_logpoint, replay_time(r, ai_info[ai_index].next_logpoint));
+		move_ai(ai_index, replay_point(r, i));
 		ai_info[ai_index].next_logpoint = i;
 		return;
 	}
@@ -2264,57 +3369,19 @@ void update_ai(int ai_index, AIStruct pos) {
 	ai_info[ai_index].next_logpoint = i;
 
 	// now search forwards again for the NEXT point after the predict_point
-    found = false;
     // PREDICT where the object would be in 4 seconds time
     double predict_time = zulu_clock + PREDICT_PERIOD;
-    int j = i;
-    while (j<ai_info[ai_index].logpoint_count-2) {
-        if (predict_time>r[j].zulu_time) j++;
-        else {
-	        found = true;
-	        break;
-        }
-    }
-    if (found) { // i.e. we have also found the predict point
+    int j = replay_find(r, count, predict_time, i);
+    if (j<count-2) { // i.e. we have also found the predict point
         // now r[j] is first ReplayPoint AFTER predict_time
-	    // progress is fraction of forward progress beyond found replay point
-	    double progress = (predict_time - r[j-1].zulu_time)/(r[j].zulu_time - r[j-1].zulu_time);
-	    progress = max(progress,0); // don't extrapolate *before* r[j-1]
-	    predict_point.latitude = r[j-1].latitude + progress * (r[j].latitude - r[j-1].latitude);
-	    predict_point.longitude = r[j-1].longitude + progress * (r[j].longitude - r[j-1].longitude);
-		// include alt_offset in alt calc
-	    predict_point.altitude = r[j-1].altitude + progress * (r[j].altitude - r[j-1].altitude) + ai_info[ai_index].alt_offset;
-	    predict_point.heading = bearing(r[j-1].latitude, r[j-1].longitude,r[j].latitude, r[j].longitude);
-		if (pos.sim_on_ground) {
-			// ON GROUND, so we can calibrate the IGC file alts with an offset
-			// temporarily disabled while I think about the issues...
-			//ai_info[ai_index].alt_offset = pos.altitude - r[j-1].altitude;
-			//if (debug) printf("%s alt_offset %.1f\n",ai_info[ai_index].atc_id, ai_info[ai_index].alt_offset);
-			predict_point.pitch = 0;
-			predict_point.bank = 0;
-		} else {
-			predict_point.bank = r[j-1].bank + progress * (r[j].bank - r[j-1].bank);
-			predict_point.pitch = r[j-1].pitch + progress * (r[j].pitch - r[j-1].pitch);
-		}
-        // now calculate steering deltas based on predict point
-        double bearing_to_wp = bearing(pos.latitude, pos.longitude,
-                                       predict_point.latitude, predict_point.longitude);
-
-        double desired = desired_heading(bearing_to_wp, predict_point.heading);
-
-        double delta = heading_delta(desired, pos.heading);
-
-        DWORD heading_rate = slew_turn_rate(bearing_to_wp, pos.heading, predict_point.heading);
-
-        DWORD ahead_rate = slew_ahead_rate(pos.latitude, pos.longitude,
-                                       predict_point.latitude, predict_point.longitude,
-                                       PREDICT_PERIOD);
-
-        DWORD bank_rate = slew_rotation_to_rate((predict_point.bank - pos.bank) / PREDICT_PERIOD);
-
-        DWORD pitch_rate = slew_rotation_to_rate((predict_point.pitch - pos.pitch) / PREDICT_PERIOD);
-
-        DWORD alt_rate = slew_alt_to_rate((pos.altitude - predict_point.altitude) / PREDICT_PERIOD);
+        AiSteer steer;
+        ai_steer(&steer, r, &ai_info[ai_index].frame, j, predict_time, PREDICT_PERIOD,
+                 ai_info[ai_index].alt_offset, &pos);
+        DWORD heading_rate = steer.heading_rate;
+        DWORD ahead_rate = steer.ahead_rate;
+        DWORD bank_rate = steer.bank_rate;
+        DWORD pitch_rate = steer.pitch_rate;
+        DWORD alt_rate = steer.alt_rate;
 
         //debug - print lat longs for excel analysis
         // time,lat,lon,alt,pitch,bank,heading,ahead rate, alt rate, pitch rate, bank rate, heading rate
@@ -2334,50 +3401,17 @@ void update_ai(int ai_index, AIStruct pos) {
                             );
         // target time,lat,lon,alt,pitch,bank,heading,||
         if (false && debug) printf(",target:,%d,%2.5f,%3.5f,%5.0f,%+2.5f,%+2.5f,%+2.5f\n",
-                            r[i].zulu_time,
-                            r[i].latitude,
-                            r[i].longitude,
-                            r[i].altitude,
-                            r[i].pitch,
-                            r[i].bank,
-                            r[i].heading );
+                            replay_time(r, i),
+                            replay_latitude(r, i),
+                            replay_longitude(r, i),
+                            replay_altitude(r, i),
+                            replay_pitch(r, i),
+                            replay_bank(r, i),
+                            replay_heading(r, i) );
         // set slew back to ON if needed
         if (!ai_info[ai_index].slew_on) ai_set_slew(ai_index, true);
 
-        hr = SimConnect_TransmitClientEvent(hSimConnect,
-						    ai_info[ai_index].id,
-						    EVENT_AXIS_SLEW_AHEAD_SET,
-						    ahead_rate,
-						    SIMCONNECT_GROUP_PRIORITY_HIGHEST,
-						    SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
-
-        hr = SimConnect_TransmitClientEvent(hSimConnect,
-						    ai_info[ai_index].id,
-						    EVENT_AXIS_SLEW_HEADING_SET,
-						    heading_rate,
-						    SIMCONNECT_GROUP_PRIORITY_HIGHEST,
-						    SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
-
-        hr = SimConnect_TransmitClientEvent(hSimConnect,
-						    ai_info[ai_index].id,
-						    EVENT_AXIS_SLEW_ALT_SET,
-						    alt_rate,
-						    SIMCONNECT_GROUP_PRIORITY_HIGHEST,
-						    SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
-
-        hr = SimConnect_TransmitClientEvent(hSimConnect,
-						    ai_info[ai_index].id,
-						    EVENT_AXIS_SLEW_BANK_SET,
-						    bank_rate,
-						    SIMCONNECT_GROUP_PRIORITY_HIGHEST,
-						    SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
-
-        hr = SimConnect_TransmitClientEvent(hSimConnect,
-						    ai_info[ai_index].id,
-						    EVENT_AXIS_SLEW_PITCH_SET,
-						    pitch_rate,
-						    SIMCONNECT_GROUP_PRIORITY_HIGHEST,
-						    SIMCONNECT_EVENT_FLAG_GROUPID_IS_PRIORITY);
+        ai_control(ai_index, ahead_rate, heading_rate, alt_rate, bank_rate, pitch_rate);
 		// send gear up/down as necessary - debug commented out for now
 		//ai_gear(ai_index, i, pos);
 	}
@@ -2388,80 +3422,614 @@ bool text_char(char m) {
 }
 
 
-// pick out a record from the igc file
+// values from the header records of an IGC file, as found by igc_header_line()
+// ("" if not in the file)
+struct IgcHeader {
+	char date[MAXBUF];             // HFDTE, DDMMYY
+	char pilot[MAXBUF];            // HFPLT
+	char glider_type[MAXBUF];      // HFGTY
+	char glider_id[MAXBUF];        // HFGID (or LCU::HPGID)
+	char competition_id[MAXBUF];   // HFCID (or LCU::HPCID)
+	char atc_id[MAXBUF];           // the last glider or competition id in the file
+	// sim_logger L records
+	char general_checksum[MAXBUF];
+	char flt_checksum[MAXBUF];
+	char wx_checksum[MAXBUF];
+	char cmx_checksum[MAXBUF];
+	char cx_checksum[MAXBUF];
+	char mission_checksum[MAXBUF];
+	char cfg_checksum[MAXBUF];
+	char air_checksum[MAXBUF];
+	char cx_status[MAXBUF];
+	char wx_status[MAXBUF];
+	char thermals_status[MAXBUF];
+};
 
-bool get_igc_record(char *out_s, char *rec, char *key) {
-	int len = strlen(key);
-	char s[MAXBUF];
-	for (int m=0;m<len;m++) s[m] = rec[m];
-	s[len] = '\0';
-	if (_stricmp(s,key)==0) {
-		int m = 0;
-		// skip leading spaces in value
-		while (rec[m+len]==' ') m++;
-		// if record is blank just return rather than overwrite value
-		if (rec[m+len]=='\0') return true;
-		while (text_char(rec[m+len])) {
-			out_s[m] = rec[m+len];
-			m++;
+void igc_header_reset(IgcHeader *h) {
+	memset(h, 0, sizeof(IgcHeader));
+}
+
+// copy the value at rec (up to the first non text_char()) into dest, unless it's blank
+bool igc_header_value(char *dest, const char *rec) {
+	while (*rec==' ') rec++;
+	if (!text_char(*rec)) return false;
+	int m = 0;
+	while (m<MAXBUF-1 && text_char(rec[m])) {
+		dest[m] = rec[m];
+		m++;
+	}
+	dest[m] = '\0';
+	if (debug) printf("%s...", dest);
+	return true;
+}
+
+// copy the value after tag into dest if rec starts with tag
+inline bool igc_header_tag(char *dest, const char *rec, const char *tag) {
+	size_t n = strlen(tag);
+	if (strncmp(rec, tag, n)!=0) return false;
+	igc_header_value(dest, rec+n);
+	return true;
+}
+
+// record type letter + 3 letter subtype, for switch()
+#define IGC_SUBTYPE(t, a, b, c) (((t)<<24) | ((a)<<16) | ((b)<<8) | (c))
+
+// an H record, e.g. "HFGTYGLIDERTYPE:DG808S", where the value follows the ':'
+// (the subtype is case insensitive and the source, F/O/P, is ignored)
+void igc_header_h(IgcHeader *h, const char *rec) {
+	const char *value = strchr(rec, ':');
+	int subtype = IGC_SUBTYPE('H', toupper((unsigned char)rec[2]),
+							  toupper((unsigned char)rec[3]), toupper((unsigned char)rec[4]));
+	switch (subtype) {
+	case IGC_SUBTYPE('H','D','T','E'):
+		// "HFDTE160726" or "HFDTEDATE:160726,01"
+		igc_header_value(h->date, (value!=NULL) ? value+1 : rec+5);
+		return;
+	}
+	if (value==NULL) return;
+	value++;
+	switch (subtype) {
+	case IGC_SUBTYPE('H','P','L','T'):
+		igc_header_value(h->pilot, value);
+		break;
+	case IGC_SUBTYPE('H','G','T','Y'):
+		igc_header_value(h->glider_type, value);
+		break;
+	case IGC_SUBTYPE('H','G','I','D'):
+		if (igc_header_value(h->glider_id, value)) strcpy_s(h->atc_id, h->glider_id);
+		break;
+	case IGC_SUBTYPE('H','C','I','D'):
+		if (igc_header_value(h->competition_id, value)) strcpy_s(h->atc_id, h->competition_id);
+		break;
+	}
+}
+
+// an "L FSX " record written by igc_write_header(), the value follows the tag
+void igc_header_l_fsx(IgcHeader *h, const char *rec) {
+	switch (IGC_SUBTYPE('L', rec[6], rec[7], rec[8])) {
+	case IGC_SUBTYPE('L','G','E','N'):
+		igc_header_tag(h->general_checksum, rec, "L FSX GENERAL CHECKSUM            ");
+		break;
+	case IGC_SUBTYPE('L','F','L','T'):
+		igc_header_tag(h->flt_checksum, rec, "L FSX FLT checksum            ");
+		break;
+	case IGC_SUBTYPE('L','W','X',' '):
+		if (igc_header_tag(h->wx_checksum, rec, "L FSX WX checksum             ")) break;
+		if (igc_header_tag(h->wx_status, rec, "L FSX WX status:              ")) break;
+		// small bugfix to accept '=' versions prior to 2.0
+		igc_header_tag(h->wx_status, rec, "L FSX WX status=              ");
+		break;
+	case IGC_SUBTYPE('L','C','M','X'):
+		igc_header_tag(h->cmx_checksum, rec, "L FSX CMX checksum            ");
+		break;
+	case IGC_SUBTYPE('L','C','u','m'):
+		if (igc_header_tag(h->cx_checksum, rec, "L FSX CumulusX.exe checksum   ")) break;
+		igc_header_tag(h->cx_status, rec, "L FSX CumulusX status:        ");
+		break;
+	case IGC_SUBTYPE('L','m','i','s'):
+		igc_header_tag(h->mission_checksum, rec, "L FSX mission checksum        ");
+		break;
+	case IGC_SUBTYPE('L','a','i','r'):
+		igc_header_tag(h->cfg_checksum, rec, "L FSX aircraft.cfg checksum   ");
+		break;
+	case IGC_SUBTYPE('L','A','I','R'):
+		igc_header_tag(h->air_checksum, rec, "L FSX AIR checksum            ");
+		break;
+	case IGC_SUBTYPE('L','T','h','e'):
+		igc_header_tag(h->thermals_status, rec, "L FSX ThermalDescriptions.xml ");
+		break;
+	}
+}
+
+// read any header values in the IGC record line_buf into h
+void igc_header_line(IgcHeader *h, char *line_buf) {
+	if (strnlen(line_buf, 9)<9) return; // too short for anything we read
+	switch (line_buf[0]) {
+	case 'H':
+	case 'h':
+		igc_header_h(h, line_buf);
+		break;
+	case 'L':
+		if (strncmp(line_buf, "L FSX ", 6)==0) igc_header_l_fsx(h, line_buf);
+		// "LCU::HPGIDGLIDERID:" etc. from SeeYou
+		else if (strncmp(line_buf, "LCU::H", 6)==0) igc_header_h(h, line_buf+5);
+		break;
+	}
+}
+
+// ai_update_pbhs() works through a tracklog GEO_BLOCK points at a time. First the
+// kinematics of the legs into and out of the block's points (ai_legs()), each leg
+// worked out once, then the pitch/bank/heading/speed of each point from those
+// (the points independently of each other).
+const int GEO_BLOCK = 256;
+
+// legs[j] is from point b+j-1 to point b+j of the block starting at point b
+// (legs[0] is the last leg of the block before)
+struct ReplayLegs {
+	double dist[GEO_BLOCK+1];    // meters
+	double bearing[GEO_BLOCK+1]; // radians, 0..2pi
+	double speed[GEO_BLOCK+1];   // meters per second
+	double turn[GEO_BLOCK+1];    // radians per second, from the bearing of the leg before
+	double target[GEO_BLOCK+1];  // bearing from this leg's midpoint to the next's
+};
+
+// kinematics of the legs out of the points of the block starting at point b, into
+// legs[1] on. legs[0] must already be set (if b>0).
+void ai_legs(ReplayLegs *legs, ReplayPoint p[], int count, int b) {
+	double lat[GEO_BLOCK+2]; // points b-1..b+GEO_BLOCK
+	double lon[GEO_BLOCK+2];
+	double mid_dist[GEO_BLOCK+1];
+	int first = max(b-1, 0);
+	int last = min(b+GEO_BLOCK, count-1);
+	int n = last - b; // legs out of the block, legs[1..n]
+	if (n<=0) return;
+	for (int k=first; k<=last; k++) {
+		lat[k-first] = p[k].latitude;
+		lon[k-first] = p[k].longitude;
+	}
+	geo_legs(lat+b-first, lon+b-first, n+1, legs->dist+1, legs->bearing+1);
+	for (int j=1; j<=n; j++) {
+		double dt = p[b+j].zulu_time - p[b+j-1].zulu_time;
+		legs->speed[j] = legs->dist[j] / dt;
+		if (b+j==1) legs->turn[j] = 0; // (first leg)
+		else {
+			double bearing_delta = fmod(legs->bearing[j] + 2*M_PI - legs->bearing[j-1], 2*M_PI);
+			if (bearing_delta>M_PI) bearing_delta = bearing_delta - 2*M_PI;
+			legs->turn[j] = bearing_delta / dt;
 		}
-		out_s[m] = '\0';
-		if (debug) printf("%s%s...", key, out_s);
-		return true;
 	}
-	return false;
+	// midpoints of the legs (from legs[0], if b>0), and the bearings between them
+	for (int k=first; k<last; k++) {
+		lat[k-first] = (lat[k-first] + lat[k-first+1]) / 2;
+		lon[k-first] = (lon[k-first] + lon[k-first+1]) / 2;
+	}
+	geo_legs(lat, lon, last-first, mid_dist, legs->target + 1-(b-first));
 }
 
-// calculate appropriate pitch/bank/heading values for replaypoint[i]
-void ai_update_pbhs(ReplayPoint p[], int i) {
-	// pitch & speed
-	if (i==0) { p[i].pitch = 0; p[i].speed = 0; }
-	else {
-		double dist = distance(p[i-1].latitude,
-								      p[i-1].longitude,
-								      p[i].latitude,
-								      p[i].longitude);
-		p[i].pitch = desired_pitch(p[i].altitude-p[i-1].altitude,
-                                        dist,
-                                        p[i].zulu_time-p[i-1].zulu_time);
-		p[i].speed = dist / (p[i].zulu_time-p[i-1].zulu_time);
-		//if (debug) printf("%d %4.1f %3.2f\n", p[i].zulu_time, p[i].altitude, p[i].speed);
+// calculate appropriate pitch/bank/heading/speed values for the count points at p
+void ai_update_pbhs(ReplayPoint p[], int count) {
+	ReplayLegs legs;
+
+	for (int b=0; b<count; b+=GEO_BLOCK) {
+		if (b>0) {
+			legs.dist[0] = legs.dist[GEO_BLOCK];
+			legs.bearing[0] = legs.bearing[GEO_BLOCK];
+			legs.speed[0] = legs.speed[GEO_BLOCK];
+			legs.turn[0] = legs.turn[GEO_BLOCK];
+		}
+		ai_legs(&legs, p, count, b);
+
+		for (int x=b; x<b+GEO_BLOCK && x<count; x++) {
+			int j = x-b; // legs[j] is the leg into x, legs[j+1] the leg out
+			// pitch & speed
+			if (x==0) { p[x].pitch = 0; p[x].speed = 0; }
+			else {
+				p[x].pitch = desired_pitch(p[x].altitude-p[x-1].altitude,
+										   legs.dist[j],
+										   p[x].zulu_time-p[x-1].zulu_time);
+				p[x].speed = legs.speed[j];
+			}
+
+			// heading: the 'target' heading between the midpoints of the legs
+			// either side, or the first/last leg's bearing at the ends
+			if (count==1) p[x].heading = 0;
+			else if (x==0) p[x].heading = legs.bearing[1];
+			else if (x==count-1) p[x].heading = legs.bearing[j];
+			else p[x].heading = legs.target[j];
+
+			// bank
+			if (x<2) p[x].bank = 0;
+			else {
+				p[x].bank = -legs.turn[j] * 4;
+				p[x].bank = min(p[x].bank, 1.5);
+				p[x].bank = max(p[x].bank, -1.5);
+			}
+		}
 	}
 
-    // heading
-    if (i==1) p[0].heading = bearing(p[0].latitude, p[0].longitude,
-                                     p[1].latitude, p[1].longitude);
-	else if (i>1) {
-		p[i-1].heading = target_heading(p[i-2].latitude, p[i-2].longitude,
-                                     p[i-1].latitude, p[i-1].longitude,
-                                     p[i].latitude, p[i].longitude);
-		//if (debug) printf("updating p[%2d-%d] (%2.5f,%2.5f) p[%2d-%d].heading=%.3f\n",
-		//	i, p[i].zulu_time,p[i].latitude, p[i].longitude,i-1,p[i-1].zulu_time,p[i-1].heading);
+	// and now do some fix up of headings for low speed stuff
+	bool valid_heading = false; // set to true when we have a reasonable speed to trust heading
+	for (int x=count-2;x>=0;x--) {
+		//check speed > 3m/s (p[x+1].speed is that of leg x -> x+1)
+		const int MIN_HEADING_SPEED = 3;
+		if (p[x+1].speed > MIN_HEADING_SPEED) {
+			valid_heading = true;
+			continue;
+		}
+		// here we must be < 3m/s, so if we have a valid heading, copy it
+		p[x].pitch = 0;
+		p[x].bank = 0;
+		if (valid_heading) p[x].heading = p[x+1].heading;
 	}
+}
 
-	// bank
-	if (i<2) p[i].bank = 0;
-	else {
-		double this_bearing = bearing(p[i-1].latitude,
-								      p[i-1].longitude,
-								      p[i].latitude,
-								      p[i].longitude);
-		double prev_bearing = bearing(p[i-2].latitude,
-								      p[i-2].longitude,
-								      p[i-1].latitude,
-								      p[i-1].longitude);
-		double bearing_delta = fmod(this_bearing + 2*M_PI - prev_bearing, 2*M_PI);
-		if (bearing_delta>M_PI) bearing_delta = bearing_delta - 2*M_PI;
-		double turn_radians_per_second = bearing_delta / (p[i].zulu_time - p[i-1].zulu_time);
-		p[i].bank = -turn_radians_per_second * 4;
-        p[i].bank = min(p[i].bank, 1.5);
-        p[i].bank = max(p[i].bank, -1.5);
+// The fixed columns of an IGC 'B' record, from column 0:
+//   B HHMMSS DDMMmmmN DDDMMmmmE V PPPPP GGGGG
+// (time, latitude and longitude in degrees and thousandths of minutes, fix
+// validity, pressure and GPS altitude in metres)
+const int IGC_B_MIN_LENGTH = 30; // up to the end of the pressure altitude
+
+struct IgcFix {
+	INT32 zulu_time;  // seconds since midnight UTC
+	double latitude;  // degrees, north positive
+	double longitude; // degrees, east positive
+	INT32 altitude;   // pressure altitude, metres
+	IgcExt ext;       // only set if the IgcExtLayout has a decoder
+};
+
+// value of the n digits at p, or -1 if they aren't all digits
+inline int igc_digits(const char *p, int n) {
+	int value = 0;
+	for (int i=0; i<n; i++) {
+		unsigned int digit = (unsigned char)p[i] - '0';
+		if (digit>9) return -1;
+		value = value*10 + digit;
+	}
+	return value;
+}
+
+// range check the fields of a B record (any <0 is invalid) and make fix from them
+inline bool igc_fix_make(IgcFix *fix, int hours, int mins, int secs,
+						 int lat_deg, int lat_mmin, char ns, int lon_deg, int lon_mmin, char ew,
+						 int alt, bool alt_invalid) {
+	if (hours<0 || hours>23 || mins<0 || mins>59 || secs<0 || secs>59) return false;
+	if (lat_deg<0 || lat_deg>90 || lat_mmin<0 || lat_mmin>=60000 || (ns!='N' && ns!='S')) return false;
+	if (lon_deg<0 || lon_deg>180 || lon_mmin<0 || lon_mmin>=60000 || (ew!='E' && ew!='W')) return false;
+	if (alt_invalid) return false;
+
+	fix->zulu_time = 3600*hours + 60*mins + secs;
+	fix->latitude = (lat_deg*60000 + lat_mmin) / 60000.0;
+	if (ns=='S') fix->latitude = -fix->latitude;
+	fix->longitude = (lon_deg*60000 + lon_mmin) / 60000.0;
+	if (ew=='W') fix->longitude = -fix->longitude;
+	fix->altitude = alt;
+	return true;
+}
+
+// decode the B record rec (length chars, needn't be '\0' terminated) into fix,
+// straight from its columns. Returns false if it isn't a valid B record.
+bool igc_decode_b(const char *rec, size_t length, IgcFix *fix) {
+	if (length<IGC_B_MIN_LENGTH || rec[0]!='B') return false;
+	int hours = igc_digits(rec+1, 2);
+	int mins = igc_digits(rec+3, 2);
+	int secs = igc_digits(rec+5, 2);
+	int lat_deg = igc_digits(rec+7, 2);
+	int lat_mmin = igc_digits(rec+9, 5); // thousandths of a minute
+	char ns = rec[14];
+	int lon_deg = igc_digits(rec+15, 3);
+	int lon_mmin = igc_digits(rec+18, 5);
+	char ew = rec[23];
+	bool alt_negative = rec[25]=='-';
+	int alt = alt_negative ? igc_digits(rec+26, 4) : igc_digits(rec+25, 5);
+	return igc_fix_make(fix, hours, mins, secs, lat_deg, lat_mmin, ns, lon_deg, lon_mmin, ew,
+						alt_negative ? -alt : alt, alt<0);
+}
+
+// SSSE3 version of igc_decode_b() for a batch of B records: for each record two
+// pshufb gather its digits (less '0') into (tens, units) pairs, one compare checks
+// they are all digits and pmaddubsw makes the 2-digit values. Anything but a
+// plain B record (too short, negative altitude, not digits) goes to igc_decode_b().
+void igc_decode_b_batch_ssse3(const char **recs, const size_t *lengths, int count,
+							  IgcFix *fixes, bool *valid) {
+	const __m128i zero_char = _mm_set1_epi8('0');
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i tens = _mm_set1_epi16(0x010A); // byte weights 10, 1
+	// columns 1-16 -> HH MM SS latDD (0,M) (M,m) (m,m) (0,lonD)
+	const __m128i shuffle_a = _mm_setr_epi8(0,1, 2,3, 4,5, 6,7, -1,8, 9,10, 11,12, -1,14);
+	// columns 14-29 -> (lonD,D) (0,M) (M,m) (m,m) (0,alt) (alt,alt) (alt,alt) (0,0)
+	const __m128i shuffle_b = _mm_setr_epi8(2,3, -1,4, 5,6, 7,8, -1,11, 12,13, 14,15, -1,-1);
+	INT16 pa[8], pb[8]; // the 2-digit values
+
+	for (int k=0; k<count; k++) {
+		const char *rec = recs[k];
+		if (lengths[k]<IGC_B_MIN_LENGTH || rec[0]!='B') {
+			valid[k] = igc_decode_b(rec, lengths[k], &fixes[k]);
+			continue;
+		}
+		__m128i a = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(rec+1)), zero_char);
+		__m128i b = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(rec+14)), zero_char);
+		a = _mm_shuffle_epi8(a, shuffle_a);
+		b = _mm_shuffle_epi8(b, shuffle_b);
+		__m128i digits = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(a, nine), nine),
+									   _mm_cmpeq_epi8(_mm_max_epu8(b, nine), nine));
+		if (_mm_movemask_epi8(digits)!=0xFFFF) {
+			valid[k] = igc_decode_b(rec, lengths[k], &fixes[k]);
+			continue;
+		}
+		_mm_storeu_si128((__m128i *)pa, _mm_maddubs_epi16(a, tens));
+		_mm_storeu_si128((__m128i *)pb, _mm_maddubs_epi16(b, tens));
+		valid[k] = igc_fix_make(&fixes[k], pa[0], pa[1], pa[2],
+								pa[3], pa[4]*10000 + pa[5]*100 + pa[6], rec[14],
+								pa[7]*100 + pb[0], pb[1]*10000 + pb[2]*100 + pb[3], rec[23],
+								pb[4]*10000 + pb[5]*100 + pb[6], false);
+	}
+}
+
+void igc_decode_b_batch_scalar(const char **recs, const size_t *lengths, int count,
+							   IgcFix *fixes, bool *valid) {
+	for (int k=0; k<count; k++) valid[k] = igc_decode_b(recs[k], lengths[k], &fixes[k]);
+}
+
+// decode count B records, valid[k] says if fixes[k] was decoded
+void igc_decode_b_batch(const char **recs, const size_t *lengths, int count,
+						IgcFix *fixes, bool *valid) {
+	if (chksum_ssse3) igc_decode_b_batch_ssse3(recs, lengths, count, fixes, valid);
+	else igc_decode_b_batch_scalar(recs, lengths, count, fixes, valid);
+}
+
+//*******************************************************************************
+// B record extensions
+//
+// The I record lists the extensions added to the end of each B record, e.g. ours
+//   I 02 3638FXA 3941ENL
+// is 2 extensions, FXA in columns 36-38 and ENL in 39-41 (counting 'B' as 1).
+// igc_ext_layout() finds the ones replay uses (ENL, TAS, VAT) and picks a decoder
+// for them: one of the igc_decode_ext_fixed<> instances if the columns are one of
+// the common layouts in igc_ext_layouts[], so the columns are constants, otherwise
+// igc_decode_ext_generic(). If the file has none of them there's no decoder, and
+// nothing more is done per B record.
+
+const int IGC_EXT_ENL = 1; // engine noise level, 000-999
+const int IGC_EXT_TAS = 2; // true airspeed, km/h
+const int IGC_EXT_VAT = 4; // compensated vario, tenths of m/s (e.g. "-15")
+
+struct IgcExtColumns {
+	int start;  // offset in the B record ('B' is 0)
+	int length; // 0 if the extension isn't in the file
+};
+
+struct IgcExtLayout;
+typedef void (*IgcExtDecoder)(const char *rec, size_t length, const IgcExtLayout *layout, IgcExt *ext);
+
+struct IgcExtLayout {
+	int fields; // IGC_EXT_ flags of the extensions in the B records
+	IgcExtColumns enl;
+	IgcExtColumns tas;
+	IgcExtColumns vat;
+	IgcExtDecoder decode; // NULL if fields==0
+};
+
+// read the n char signed number at p into value, false if it isn't a number
+inline bool igc_ext_value(const char *p, int n, int *value) {
+	bool negative = n>1 && p[0]=='-';
+	int v = negative ? igc_digits(p+1, n-1) : igc_digits(p, n);
+	if (v<0) return false;
+	*value = negative ? -v : v;
+	return true;
+}
+
+// set ext from the B record rec, with the ENL, TAS and VAT columns known at
+// compile time (a 0 length means the file doesn't have that one)
+template <int ENL, int ENL_LENGTH, int TAS, int TAS_LENGTH, int VAT, int VAT_LENGTH>
+void igc_decode_ext_fixed(const char *rec, size_t length, const IgcExtLayout *layout, IgcExt *ext) {
+	int v;
+	*ext = igc_ext_none;
+	if (ENL_LENGTH>0 && length>=ENL+ENL_LENGTH && igc_ext_value(rec+ENL, ENL_LENGTH, &v)) ext->enl = v;
+	if (TAS_LENGTH>0 && length>=TAS+TAS_LENGTH && igc_ext_value(rec+TAS, TAS_LENGTH, &v)) ext->tas = v / 3.6;
+	if (VAT_LENGTH>0 && length>=VAT+VAT_LENGTH && igc_ext_value(rec+VAT, VAT_LENGTH, &v)) ext->vario = v / 10.0;
+}
+
+// as igc_decode_ext_fixed() for any layout
+void igc_decode_ext_generic(const char *rec, size_t length, const IgcExtLayout *layout, IgcExt *ext) {
+	int v;
+	*ext = igc_ext_none;
+	const IgcExtColumns *c = &layout->enl;
+	if (c->length>0 && length>=(size_t)(c->start+c->length) && igc_ext_value(rec+c->start, c->length, &v))
+		ext->enl = v;
+	c = &layout->tas;
+	if (c->length>0 && length>=(size_t)(c->start+c->length) && igc_ext_value(rec+c->start, c->length, &v))
+		ext->tas = v / 3.6;
+	c = &layout->vat;
+	if (c->length>0 && length>=(size_t)(c->start+c->length) && igc_ext_value(rec+c->start, c->length, &v))
+		ext->vario = v / 10.0;
+}
+
+// common extension layouts, with their decoders
+struct IgcExtFixedLayout {
+	IgcExtColumns enl, tas, vat;
+	IgcExtDecoder decode;
+};
+
+IgcExtFixedLayout igc_ext_layouts[] = {
+	// I023638FXA3941ENL (sim_logger)
+	{ {38,3}, {0,0}, {0,0}, igc_decode_ext_fixed<38,3, 0,0, 0,0> },
+	// I033638FXA3940SIU4143ENL
+	{ {40,3}, {0,0}, {0,0}, igc_decode_ext_fixed<40,3, 0,0, 0,0> },
+	// I033638FXA3941ENL4244TAS
+	{ {38,3}, {41,3}, {0,0}, igc_decode_ext_fixed<38,3, 41,3, 0,0> },
+	// I043638FXA3941ENL4246TAS4750VAT
+	{ {38,3}, {41,5}, {46,4}, igc_decode_ext_fixed<38,3, 41,5, 46,4> },
+	// I043638FXA3940SIU4143ENL4446TAS
+	{ {40,3}, {43,3}, {0,0}, igc_decode_ext_fixed<40,3, 43,3, 0,0> }
+};
+
+const int IGC_EXT_LAYOUTS = sizeof(igc_ext_layouts) / sizeof(igc_ext_layouts[0]);
+
+inline bool igc_ext_same(IgcExtColumns a, IgcExtColumns b) {
+	return a.start==b.start && a.length==b.length;
+}
+
+// no extensions (until an I record is read)
+void igc_ext_reset(IgcExtLayout *layout) {
+	layout->fields = 0;
+	layout->enl.start = layout->enl.length = 0;
+	layout->tas = layout->vat = layout->enl;
+	layout->decode = NULL;
+}
+
+// set layout from the I record line_buf
+void igc_ext_layout(IgcExtLayout *layout, char *line_buf) {
+	igc_ext_reset(layout);
+	if (line_buf[0]!='I') return;
+	int count = igc_digits(line_buf+1, 2);
+	for (int i=0; i<count; i++) {
+		char *e = line_buf + 3 + 7*i; // SSFFCCC, start and finish columns and code
+		if (strnlen(e, 7)<7) break;
+		int start = igc_digits(e, 2);
+		int finish = igc_digits(e+2, 2);
+		if (start<=IGC_B_MIN_LENGTH || finish<start) continue;
+		IgcExtColumns c = { start-1, finish-start+1 };
+		if (strncmp(e+4, "ENL", 3)==0) {
+			layout->enl = c;
+			layout->fields |= IGC_EXT_ENL;
+		}
+		else if (strncmp(e+4, "TAS", 3)==0) {
+			layout->tas = c;
+			layout->fields |= IGC_EXT_TAS;
+		}
+		else if (strncmp(e+4, "VAT", 3)==0) {
+			layout->vat = c;
+			layout->fields |= IGC_EXT_VAT;
+		}
+	}
+	if (layout->fields==0) return;
+	layout->decode = igc_decode_ext_generic;
+	for (int i=0; i<IGC_EXT_LAYOUTS; i++) {
+		if (igc_ext_same(layout->enl, igc_ext_layouts[i].enl) &&
+			igc_ext_same(layout->tas, igc_ext_layouts[i].tas) &&
+			igc_ext_same(layout->vat, igc_ext_layouts[i].vat)) {
+			layout->decode = igc_ext_layouts[i].decode;
+			break;
+		}
 	}
+	if (debug) printf("(I record %s%s%s%s) ", (layout->fields & IGC_EXT_ENL) ? "ENL " : "",
+					  (layout->fields & IGC_EXT_TAS) ? "TAS " : "", (layout->fields & IGC_EXT_VAT) ? "VAT " : "",
+					  (layout->decode==igc_decode_ext_generic) ? "generic" : "fixed");
+}
 
+const int IGC_B_BATCH = 64; // most B records decoded together by igc_reader_b_run()
+
+// read the run of whole B records (up to max of them, max<=IGC_B_BATCH) that starts
+// at r's position in the current block, checksumming them as one block and decoding
+// them with igc_decode_b_batch(). Returns how many were read, 0 if the next line
+// isn't a B record or doesn't end in this block (igc_reader_next() will get it).
+// The fixes' extensions are decoded too if ext has a decoder.
+int igc_reader_b_run(IgcReader *r, IgcFix *fixes, bool *valid, int max, const IgcExtLayout *ext = NULL) {
+	const char *recs[IGC_B_BATCH];
+	size_t lengths[IGC_B_BATCH];
+	FileReader *f = &r->file;
+	const char *start = f->data + f->pos;
+	const char *end = f->data + f->size;
+	const char *line = start;
+	int n = 0;
+
+	while (n<max && line<end && *line=='B') {
+		const char *nl = (const char *)memchr(line, '\n', end-line);
+		if (nl==NULL) break;
+		recs[n] = line;
+		lengths[n] = nl+1-line;
+		n++;
+		line = nl+1;
+	}
+	if (n==0) return 0;
+	if (!r->g_found) chksum_block(&r->chk_data, start, line-start);
+	f->pos = line - f->data;
+	igc_decode_b_batch(recs, lengths, n, fixes, valid);
+	if (ext!=NULL && ext->decode!=NULL) {
+		for (int k=0; k<n; k++)
+			if (valid[k]) ext->decode(recs[k], lengths[k], ext, &fixes[k].ext);
+	}
+	return n;
 }
+
+// the zulu time of the last valid B record in data[0..size), -1 if there isn't one
+INT32 igc_last_b_time(const char *data, size_t size) {
+	IgcFix fix;
+	size_t end = size; // the line is data[start..end)
+	while (end>0) {
+		size_t start = end-1;
+		while (start>0 && data[start-1]!='\n') start--;
+		if (data[start]=='B' && igc_decode_b(data+start, end-start, &fix)) return fix.zulu_time;
+		end = start;
+	}
+	return -1;
+}
+
+// read just enough of the tracklog load->path for the loader to know when it's
+// needed: the times of its first and last valid B records, and the header records
+// before them for its AI title and ATC id. false if it has no B records to replay.
+bool igc_scan_file(ReplayLoad *load) {
+	double t = perf_seconds();
+	AIInfo *info = &load->info;
+	IgcReader r;
+	const char *line; // next line of the file, in place
+	size_t length;
+	char line_buf[MAXBUF];
+	IgcHeader header;
+	IgcFix fix;
+	bool found = false; // first valid B record
+
+	if (!igc_reader_open(&r, load->path)) {
+		if (debug) wprintf(L"%s: can't be opened\n", load->path);
+		return false;
+	}
+	igc_header_reset(&header);
+	while (!found && igc_reader_next(&r, &line, &length)) {
+		if (line[0]=='B') {
+			found = igc_decode_b(line, length, &fix);
+			continue;
+		}
+		size_t n = min(length, (size_t)(MAXBUF-1));
+		memcpy(line_buf, line, n);
+		line_buf[n] = '\0';
+		if (line_buf[0]!='I') igc_header_line(&header, line_buf);
+	}
+	if (found) {
+		load->start_time = load->end_time = fix.zulu_time;
+		if (r.file.mapped) {
+			// the whole file is there: look back from the end for the last B record
+			INT32 end = igc_last_b_time(r.file.data + r.file.pos, r.file.size - r.file.pos);
+			if (end>=0) load->end_time = end;
+		}
+		else {
+			// a streamed file has to be read through
+			while (igc_reader_next(&r, &line, &length)) {
+				if (line[0]=='B' && igc_decode_b(line, length, &fix)) load->end_time = fix.zulu_time;
+			}
+		}
+		load->start_time += test_time_offset;
+		load->end_time += test_time_offset;
+	}
+	file_close(&r.file);
+
+	clean_string(line_buf, ini_default_aircraft);
+	strcpy_s(info->title, line_buf);
+	strcpy_s(info->atc_id, MAXBUF, "XXXX");
+	if (header.glider_type[0]!='\0') strcpy_s(info->title, header.glider_type);
+	if (header.atc_id[0]!='\0') strcpy_s(info->atc_id, header.atc_id);
+	load->t_scan = perf_seconds() - t;
+	if (!found && debug) wprintf(L"%s: no B records, not replayed\n", load->path);
+	return found;
+}
+
 // load an IGC file into the replay buffer
 
-int load_igc_file(int ai_index, wchar_t path[MAXBUF]) {
+// load the tracklog load->path into load->info and load->track, reading its points
+// into the scratch arena. 0 if OK, -1 if it's not to be replayed.
+int load_igc_file(ReplayLoad *load, ReplayArena *scratch) {
+	wchar_t *path = load->path;
+	AIInfo *info = &load->info;
+	double t = perf_seconds();
 	// see if the .IGC file actually exists
 	if(_waccess_s(path, 0) != 0) {
 		// file not found
@@ -2469,150 +4037,103 @@ int load_igc_file(int ai_index, wchar_t path[MAXBUF]) {
 		return -1;
 	} else {
 		// file exists
-		FILE *f;
-		errno_t err;
+		IgcReader r;
+		const char *line; // next line of the file, in place
+		size_t length;
 		char line_buf[MAXBUF];
-		char s[MAXBUF];
 		int i = 0; // record counter
-		int j = 0; // general counter
-		ReplayPoint *p = replay[ai_index];
+		ReplayPoint *p = replay_arena_top(scratch);
 
-		if( (err = _wfopen_s(&f, path, L"r")) != 0 ) {
+		if (p==NULL || !igc_reader_open(&r, path)) {
 			return -1;
 		}
+		load->t_open = perf_seconds() - t;
+		t = perf_seconds();
 
 		// initialise the aircraft title to ini_default_aircraft
         // but this will get overwritten if there's a glider type in the IGC file
         clean_string(line_buf, ini_default_aircraft);
-		strcpy_s(ai_info[ai_index].title, line_buf);
+		strcpy_s(info->title, line_buf);
 		// initialise ATC_ID
-		strcpy_s(ai_info[ai_index].atc_id, MAXBUF, "XXXX");
-
-		while (fgets(line_buf, MAXBUF, f)!=NULL) {
-			if (get_igc_record(ai_info[ai_index].title,line_buf,"HFGTYGLIDERTYPE:"))
-				continue;
-			if (get_igc_record(ai_info[ai_index].atc_id,line_buf,"HFCIDCOMPETITIONID:"))
-				continue;
-			if (get_igc_record(ai_info[ai_index].atc_id,line_buf,"HFGIDGLIDERID:"))
-				continue;
-			if (get_igc_record(ai_info[ai_index].atc_id,line_buf,"LCU::HPGIDGLIDERID:"))
-				continue;
-			if (get_igc_record(ai_info[ai_index].atc_id,line_buf,"LCU::HPCIDCOMPETITIONID:"))
-				continue;
-			if (get_igc_record(ai_info[ai_index].atc_id,line_buf,"HFCID Competition ID    :"))
+		strcpy_s(info->atc_id, MAXBUF, "XXXX");
+
+		IgcFix fixes[IGC_B_BATCH];
+		bool valid[IGC_B_BATCH];
+		int run; // number of B records in fixes[]
+		IgcExtLayout ext; // B record extensions, from the I record
+		igc_ext_reset(&ext);
+		IgcHeader header;
+		igc_header_reset(&header);
+		const int IGC_ARENA_SLACK = 8; // room for a point and any interpolated before it
+		bool arena_full = false;
+		while ((run = igc_reader_b_run(&r, fixes, valid, IGC_B_BATCH, &ext))>0 ||
+			   igc_reader_next(&r, &line, &length)) {
+			if (run==0 && line[0]!='B') {
+				// copy the (few) other records for igc_header_line()
+				size_t n = min(length, (size_t)(MAXBUF-1));
+				memcpy(line_buf, line, n);
+				line_buf[n] = '\0';
+				if (line_buf[0]=='I') igc_ext_layout(&ext, line_buf);
+				else igc_header_line(&header, line_buf);
 				continue;
+			}
+			if (run==0) {
+				// B record not wholly in this block
+				valid[0] = igc_decode_b(line, length, &fixes[0]);
+				if (valid[0] && ext.decode!=NULL) ext.decode(line, length, &ext, &fixes[0].ext);
+				run = 1;
+			}
 
-			if (line_buf[0]!='B') continue;
-			//if (debug) printf("input: %s",line_buf);
-			j = 0;
-			s[j++] = line_buf[1]; // HH
-			s[j++] = line_buf[2];
-			s[j++] = ' ';
-			s[j++] = line_buf[3]; // MM
-			s[j++] = line_buf[4];
-			s[j++] = ' ';
-			s[j++] = line_buf[5]; // SS
-			s[j++] = line_buf[6];
-			s[j++] = ' ';
-			s[j++] = line_buf[7]; // DD latitude
-			s[j++] = line_buf[8];
-			s[j++] = ' ';
-			s[j++] = line_buf[9]; // MM
-			s[j++] = line_buf[10];
-			s[j++] = '.';
-			s[j++] = line_buf[11]; // mmm
-			s[j++] = line_buf[12];
-			s[j++] = line_buf[13];
-			s[j++] = ' ';
-			s[j++] = line_buf[14]; // N/S (N positive)
-			//s[j++] = ' ';
-			s[j++] = line_buf[15]; // DDD longitude
-			s[j++] = line_buf[16];
-			s[j++] = line_buf[17];
-			s[j++] = ' ';
-			s[j++] = line_buf[18]; // MM
-			s[j++] = line_buf[19];
-			s[j++] = '.';
-			s[j++] = line_buf[20]; // mmm
-			s[j++] = line_buf[21];
-			s[j++] = line_buf[22];
-			s[j++] = ' ';
-			s[j++] = line_buf[23]; // E/W (E positive)
-			//s[j++] = ' ';
-			s[j++] = line_buf[25]; // alt
-			s[j++] = line_buf[26];
-			s[j++] = line_buf[27];
-			s[j++] = line_buf[28]; 
-			s[j++] = line_buf[29];
-			s[j++] = '\0';
-			// if (debug) printf("Parsed to: %s\n",s);
-			// now parse s into floats using sscanf
-			int hours,mins,secs, d_lat, d_long, alt;
-			float m_lat,m_long, angle;
-			char ns, ew; // north/south, east/west
-			sscanf_s(s, "%d %d %d %d %f %c %d %f %c %d",
-						&hours,&mins,&secs,&d_lat, &m_lat, &ns, 1, &d_long, &m_long, &ew, 1, &alt);
-
-			//if (debug) {
-			//	printf("result:    %d,%d,%d,%d,%f,'%c',%d,%f,'%c',%d\n\n",
-			//			hours,mins,secs,d_lat, m_lat, ns, d_long, m_long, ew, alt);
-			//}
-			// latitude
-			angle = (d_lat + m_lat/60);
-			if (ns=='S')  angle = -angle;
-			p[i].latitude = angle + test_lat_offset;
-
-			// longitude
-			angle = (d_long + m_long/60);
-			if (ew=='W')  angle = -angle;
-			p[i].longitude = angle + test_lon_offset;
-
-			// altitude
-			p[i].altitude = alt + test_alt_offset;
-
-			// time
-			p[i].zulu_time = 3600*hours+60*mins+secs+test_time_offset;
-
-			// now we can insert some interpolated points if needed
-			const int IGC_GAP_TIME = 12; // do NOT try and interpolate a gap >12 seconds
-			const int IGC_DELTA_MAX = 5; // if gap >5 seconds then insert interpolated point
-			const int IGC_INTERP_TIMESTEP = 3; // interpolate at 3 second intervals
-			if (i>2 && (p[i-1].zulu_time-p[i-2].zulu_time)<= IGC_GAP_TIME) {
-				while ((p[i-1].zulu_time-p[i-2].zulu_time)>IGC_DELTA_MAX) {
-					// calc an interp point after p[i-2]
-					ReplayPoint p_interp = interp(p[i-3],p[i-2],p[i-1],p[i],IGC_INTERP_TIMESTEP);
-					// shuffle up points to allow insert
-					p[i+1] = p[i];
-					p[i] = p[i-1];
-					p[i-1] = p_interp; // this will be the next point we interpolate from
-					//ai_update_pbh(p, i-1); // update pitch/bank/heading of interp point
-					i = i+1;
+			// B records, decoded in place
+			for (int k=0; k<run; k++) {
+				if (!valid[k]) continue;
+				if (!replay_arena_fit(scratch, (i+IGC_ARENA_SLACK)*sizeof(ReplayPoint))) {
+					arena_full = true;
+					break;
 				}
+				p[i].latitude = fixes[k].latitude + test_lat_offset;
+				p[i].longitude = fixes[k].longitude + test_lon_offset;
+				p[i].altitude = fixes[k].altitude + test_alt_offset;
+				p[i].zulu_time = fixes[k].zulu_time + test_time_offset;
+				p[i].ext = (ext.decode!=NULL) ? fixes[k].ext : igc_ext_none;
+
+				// now we can insert some interpolated points if needed
+				const int IGC_GAP_TIME = 12; // do NOT try and interpolate a gap >12 seconds
+				const int IGC_DELTA_MAX = 5; // if gap >5 seconds then insert interpolated point
+				const int IGC_INTERP_TIMESTEP = 3; // interpolate at 3 second intervals
+				if (i>2 && (p[i-1].zulu_time-p[i-2].zulu_time)<= IGC_GAP_TIME) {
+					while ((p[i-1].zulu_time-p[i-2].zulu_time)>IGC_DELTA_MAX) {
+						// calc an interp point after p[i-2]
+						ReplayPoint p_interp = interp(p[i-3],p[i-2],p[i-1],p[i],IGC_INTERP_TIMESTEP);
+						// shuffle up points to allow insert
+						p[i+1] = p[i];
+						p[i] = p[i-1];
+						p[i-1] = p_interp; // this will be the next point we interpolate from
+						//ai_update_pbh(p, i-1); // update pitch/bank/heading of interp point
+						i = i+1;
+					}
+				}
+				i++;
 			}
-			i++;
 		}
-		fclose(f);
+		info->chksum_result = igc_reader_close(&r);
+		info->ext_fields = ext.fields;
+		if (arena_full && debug) wprintf(L"%s: replay arena full, %d points loaded\n", path, i);
+		if (header.glider_type[0]!='\0') strcpy_s(info->title, header.glider_type);
+		if (header.atc_id[0]!='\0') strcpy_s(info->atc_id, header.atc_id);
+		if (ini_replay_verified_only && info->chksum_result!=CHKSUM_OK) {
+			if (debug) wprintf(L"%s: checksum NOT OK, not replayed (replay_verified_only)\n", path);
+			return -1;
+		}
+		load->t_parse = perf_seconds() - t;
+		t = perf_seconds();
 
 		// now update all the pitch/bank/heading values
-		for (int x=0; x<i; x++) ai_update_pbhs(p,x);
-
-		// and now do some fix up of headings for low speed stuff
-		bool valid_heading = false; // set to true when we have a reasonable speed to trust heading
-		for (int x=i-2;x>=0;x--) {
-			//check speed > 3m/s
-			const int MIN_HEADING_SPEED = 3;
-			if (distance(p[x].latitude,p[x].longitude,p[x+1].latitude,p[x+1].longitude)/(p[x+1].zulu_time-p[x].zulu_time) > MIN_HEADING_SPEED) {
-				valid_heading = true;
-				continue;
-			}
-			// here we must be < 3m/s, so if we have a valid heading, copy it
-			p[x].pitch = 0;
-			p[x].bank = 0;
-			if (valid_heading) p[x].heading = p[x+1].heading;
-		}
+		ai_update_pbhs(p, i);
+		load->t_kinematics = perf_seconds() - t;
+		t = perf_seconds();
 
 		if (debug) {
-			wprintf(L"\n",path);
             //debug print IGC file
 			//for (int x=0; x<i; x++)
 			//	printf("%04d,time,%d,lat,%2.5f,lon,%3.5f,alt,%5.0f,pitch,%.3f,bank,%.3f,heading,%.3f\n",
@@ -2625,23 +4146,63 @@ int load_igc_file(int ai_index, wchar_t path[MAXBUF]) {
 			//		p[x].bank,
 			//		p[x].heading);
 		}
-		ai_info[ai_index].logpoint_count = i;
-		ai_info[ai_index].next_logpoint = 0;
-		ai_info[ai_index].alt_offset = 0;
-		ai_info[ai_index].created = false;
-		ai_info[ai_index].default_tried = false;
-		ai_info[ai_index].gear_up = false;
-		ai_info[ai_index].gear_up_disable_timeout = 0;
-		ai_info[ai_index].slew_on = false;
+		// (the scratch arena is used again for the next tracklog)
+		bool packed = replay_pack(scratch, &load->track, p, i, ext.fields!=0) &&
+					  replay_arena_copy(&load->track, i, ext.fields!=0);
+		scratch->used = 0;
+		if (!packed) {
+			if (debug) wprintf(L"%s: replay arena full, not replayed\n", path);
+			return -1;
+		}
+		load->t_pack = perf_seconds() - t;
+		info->logpoint_count = i;
+		info->next_logpoint = 0;
+		info->frame.point = -1;
+		info->alt_offset = 0;
+		info->created = false;
+		info->default_tried = false;
+		info->gear_up = false;
+		info->gear_up_disable_timeout = 0;
+		info->slew_on = false;
 		return 0;
 	}
 }
 
-// load all IGC files from a folder
+// replay loader thread: scan or load the next tracklog in replay_loader that needs
+// it, each time the work semaphore is released (until the loader's stopped)
+unsigned __stdcall replay_load_thread(void *arg) {
+	ReplayLoader *l = &replay_loader;
+	ReplayArena scratch = { NULL, 0, 0, 0, REPLAY_SCRATCH_RESERVE };
+	while (WaitForSingleObject(l->work, INFINITE)==WAIT_OBJECT_0 && !l->cancel) {
+		for (int i=0; i<l->count; i++) {
+			ReplayLoad *load = &l->loads[i];
+			if (InterlockedCompareExchange(&load->state, REPLAY_LOAD_LOADING, REPLAY_LOAD_DUE)==REPLAY_LOAD_DUE) {
+				bool ok = load_igc_file(load, &scratch)==0;
+				load->t_done = perf_seconds();
+				InterlockedExchange(&load->state, ok ? REPLAY_LOAD_READY : REPLAY_LOAD_FAILED);
+				replay_load_done(l, i);
+				break;
+			}
+			if (InterlockedCompareExchange(&load->state, REPLAY_LOAD_SCANNING, REPLAY_LOAD_FOUND)==REPLAY_LOAD_FOUND) {
+				bool ok = igc_scan_file(load);
+				InterlockedExchange(&load->state, ok ? REPLAY_LOAD_WAITING : REPLAY_LOAD_FAILED);
+				replay_load_done(l, i);
+				break;
+			}
+		}
+	}
+	replay_arena_release(&scratch);
+	return 0;
+}
+
+// load all IGC files from a folder: find them, and start the loader threads
+// scanning them (replay_load_poll() has them loaded as they're needed)
 void load_igc_files(char *folder) {
+	ReplayLoader *l = &replay_loader;
 	wchar_t wfolder[MAXBUF];
 	size_t wlen; // length of unicode folder name
 	if (debug) printf("Loading IGC files...\n");
+	replay_load_stop();
 	// see if the .FLT file actually exists
 	if(_access_s(folder, 0) != 0) {
 		// folder not found
@@ -2655,24 +4216,183 @@ void load_igc_files(char *folder) {
 	// iterate through the files
 	WIN32_FIND_DATA next_file;
 	HANDLE h;
+	l->t_start = perf_seconds();
 	h = FindFirstFile(L"*.igc", &next_file);
 	if (h == INVALID_HANDLE_VALUE) {
 		if (debug) printf("No IGC files found in folder\n");
 		return; // didn't even find 1 file in that folder
 	}
+	int size = 0;
+	l->count = 0;
 	do {
         // skip files that contain "[X]"
         if (wcsstr(next_file.cFileName,tracklog_skip_string)!=NULL) {
             if (debug) wprintf(L"Skipping tracklog %s\n", next_file.cFileName);
             continue;
         }
-		if (debug) wprintf(L"Loading file %s...", next_file.cFileName);
-		if (load_igc_file(ai_count, next_file.cFileName)==0) {
-			create_ai(ai_count);
-			ai_count++;
+		if (l->count==size) {
+			size = max(2*size, 64);
+			ReplayLoad *loads = (ReplayLoad *)realloc(l->loads, size*sizeof(ReplayLoad));
+			if (loads==NULL) break;
+			l->loads = loads;
+		}
+		ReplayLoad *load = &l->loads[l->count++];
+		memset(load, 0, sizeof(ReplayLoad));
+		load->state = REPLAY_LOAD_FOUND;
+		swprintf_s(load->path, MAXBUF, L"%s\\%s", wfolder, next_file.cFileName);
+	} while (FindNextFile(h,&next_file));
+	FindClose(h);
+	l->t_find = perf_seconds() - l->t_start;
+	l->t_wait = 0;
+	l->t_create = 0;
+	l->freed = 0;
+	l->working_set = replay_arena_working_set();
+	l->events = (ReplayEvent *)malloc(l->count*sizeof(ReplayEvent));
+	l->done = (int *)malloc(l->count*sizeof(int));
+	l->taken = (int *)malloc(l->count*sizeof(int));
+	if (l->count==0 || l->events==NULL || l->done==NULL || l->taken==NULL ||
+		replay_arena_top(&replay_arena)==NULL) {
+		replay_load_stop();
+		return;
+	}
+	// nothing is due until zulu_clock has the new flight's time
+	zulu_clock_synced = false;
+
+	// leave a CPU for FSX
+	l->cancel = 0;
+	l->work = CreateSemaphore(NULL, l->count, MAXLONG, NULL);
+	int threads = max(1, min(min(chksum_cpus-1, CHKSUM_MAX_THREADS), l->count));
+	for (int i=0; l->work!=NULL && i<threads; i++) {
+		l->threads[l->thread_count] = (HANDLE)_beginthreadex(NULL, 0, replay_load_thread, NULL, 0, NULL);
+		if (l->threads[l->thread_count]!=0) l->thread_count++;
+	}
+	if (l->thread_count==0) {
+		// couldn't start a thread so scan them here (and load them in replay_load_poll())
+		for (int i=0; i<l->count; i++) {
+			l->loads[i].state = igc_scan_file(&l->loads[i]) ? REPLAY_LOAD_WAITING : REPLAY_LOAD_FAILED;
+			replay_load_done(l, i);
+		}
+	}
+}
+
+// the loader's stage timings and memory use, once it's finished
+void replay_load_debug() {
+	ReplayLoader *l = &replay_loader;
+	double t_scan = 0, t_open = 0, t_parse = 0, t_kinematics = 0, t_pack = 0;
+	int loaded = 0;
+	for (int i=0; i<l->count; i++) {
+		t_scan += l->loads[i].t_scan;
+		t_open += l->loads[i].t_open;
+		t_parse += l->loads[i].t_parse;
+		t_kinematics += l->loads[i].t_kinematics;
+		t_pack += l->loads[i].t_pack;
+		if (l->loads[i].t_done>0) loaded++;
+	}
+	printf("Replay load: %d tracklogs, %d loaded, on %d threads\n", l->count, loaded, l->thread_count);
+	printf("    find %.0f ms, scan %.0f ms, open %.0f ms, parse %.0f ms, kinematics %.0f ms, pack %.0f ms (thread time)\n",
+		   l->t_find * 1000, t_scan * 1000, t_open * 1000, t_parse * 1000, t_kinematics * 1000, t_pack * 1000);
+	printf("    waiting for pickup %.0f ms, create_ai %.0f ms\n", l->t_wait * 1000, l->t_create * 1000);
+	printf("Replay arena: %d tracklogs, %.1f MB used, %.1f MB freed after replay, resident %.0f MB -> %.0f MB\n",
+		   ai_count, replay_arena.used / (1024.0*1024.0), l->freed / (1024.0*1024.0),
+		   l->working_set, replay_arena_working_set());
+}
+
+// replay_load_poll() on a load the threads have finished with
+void replay_load_taken(ReplayLoader *l, int i) {
+	ReplayLoad *load = &l->loads[i];
+	switch (load->state) {
+	case REPLAY_LOAD_WAITING:
+		l->scanned++;
+		replay_event_push(l, load->start_time - ini_replay_lookahead, i);
+		break;
+	case REPLAY_LOAD_READY:
+		l->t_wait += perf_seconds() - load->t_done;
+		replay_event_push(l, load->start_time - REPLAY_CREATE_AHEAD, i);
+		break;
+	case REPLAY_LOAD_FAILED:
+		if (load->t_done==0) l->scanned++;
+		l->finished++;
+		break;
+	}
+}
+
+// replay_load_poll() on a load whose event is due
+void replay_load_event(ReplayLoader *l, int i) {
+	ReplayLoad *load = &l->loads[i];
+	switch (load->state) {
+	case REPLAY_LOAD_WAITING:
+		if (load->end_time>=load->start_time && load->end_time<zulu_clock) {
+			if (debug) wprintf(L"%s: ended before sim time, not loaded\n", load->path);
+			load->state = REPLAY_LOAD_DONE;
+			l->finished++;
+			break;
 		}
-	} while (FindNextFile(h,&next_file));
-	FindClose(h);
+		load->state = REPLAY_LOAD_DUE;
+		if (l->thread_count>0) ReleaseSemaphore(l->work, 1, NULL);
+		else {
+			// no loader threads
+			load->state = load_igc_file(load, &l->scratch)==0 ? REPLAY_LOAD_READY : REPLAY_LOAD_FAILED;
+			load->t_done = perf_seconds();
+			replay_load_taken(l, i);
+		}
+		break;
+	case REPLAY_LOAD_READY: {
+		if (ai_count==MAX_AI) {
+			if (debug) wprintf(L"%s: only %d tracklogs can be replayed\n", load->path, MAX_AI);
+			l->freed += replay_arena_free_track(&load->track, load->info.logpoint_count, load->info.ext_fields!=0);
+			load->state = REPLAY_LOAD_FAILED;
+			l->finished++;
+			break;
+		}
+		if (debug) wprintf(L"Loaded %s (%d points, checksum %s)\n", load->path, load->info.logpoint_count,
+						   load->info.chksum_result==CHKSUM_OK ? L"OK" : L"NOT OK");
+		double t = perf_seconds();
+		load->ai_index = ai_count;
+		ai_info[ai_count] = load->info;
+		replay[ai_count] = load->track;
+		create_ai(ai_count);
+		ai_count++;
+		l->t_create += perf_seconds() - t;
+		load->state = REPLAY_LOAD_REPLAYING;
+		// (a tracklog that goes past midnight is left to update_ai(), and freed by reset_ai())
+		if (load->end_time>=load->start_time) replay_event_push(l, load->end_time, i);
+		break;
+	}
+	case REPLAY_LOAD_REPLAYING: {
+		// the end of its tracklog
+		AIInfo *info = &ai_info[load->ai_index];
+		remove_ai(load->ai_index);
+		l->freed += replay_arena_free_track(&replay[load->ai_index], info->logpoint_count, info->ext_fields!=0);
+		info->logpoint_count = 0;
+		load->state = REPLAY_LOAD_DONE;
+		l->finished++;
+		break;
+	}
+	}
+}
+
+// called from the dispatch loop: take the loads the loader threads have finished,
+// and deal with the events that are due
+void replay_load_poll() {
+	ReplayLoader *l = &replay_loader;
+	if (l->loads==NULL) return;
+	if (l->done_count>0) {
+		EnterCriticalSection(&l->done_lock);
+		int n = l->done_count;
+		memcpy(l->taken, l->done, n*sizeof(int));
+		l->done_count = 0;
+		LeaveCriticalSection(&l->done_lock);
+		int scanned = l->scanned;
+		for (int i=0; i<n; i++) replay_load_taken(l, l->taken[i]);
+		if (debug && scanned<l->count && l->scanned==l->count)
+			printf("Replay load: %d tracklogs scanned in %.0f ms\n", l->count, (perf_seconds() - l->t_start) * 1000);
+	}
+	// nothing is due until zulu_clock has the flight's time
+	while (zulu_clock_synced && l->event_count>0 && l->events[0].time<=zulu_clock)
+		replay_load_event(l, replay_event_pop(l).load);
+	if (l->finished<l->count) return;
+	if (debug) replay_load_debug();
+	replay_load_stop();
 }
 
 //**********************************************************************************
@@ -2733,6 +4453,8 @@ void process_flt_load_msg(char *flt_filepath) {
     flush_igc(L"auto-save");
 	igc_reset_log();
 	reset_ai();
+	// finish any checksums from the last flight before the globals are reused
+	chksum_files_wait();
 
 	// see if the .FLT file actually exists
 	if(_access_s(flt_filepath, 0) != 0) {
@@ -2789,12 +4511,14 @@ void process_flt_load_msg(char *flt_filepath) {
 		c_pointer[3] = 'L';
 		c_pointer[4] = '\0';
 	}
-	// calculate checksum for FLT, WX, CMX, XML files
-	chksum_binary_file(chksum_flt, flt_pathname);
-	if (chksum_binary_file(chksum_wx, wx_pathname)==CHKSUM_OK)
+	// calculate checksum for FLT, WX, CMX, XML files in the background
+	// (igc_write_file() waits for them)
+	chksum_file_start(chksum_flt, flt_pathname);
+	if (_access_s(wx_pathname, 4) == 0) // WX file is readable
 		wx_code = 1;
-	chksum_binary_file(chksum_cmx, cmx_pathname);
-	chksum_binary_file(chksum_xml, xml_pathname);
+	chksum_file_start(chksum_wx, wx_pathname);
+	chksum_file_start(chksum_cmx, cmx_pathname);
+	chksum_file_start(chksum_xml, xml_pathname);
     // now checksum the cumulusx.exe file
     chksum_cumulusx_exe();
 
@@ -3101,22 +4825,11 @@ void menu_tracklog_init() {
     strcpy_s(menu_tracklog_thermals_status,"(not in tracklog)");
 }
 
-bool igc_read(char line_buf[], char tag[], char* dest) {
-    char s[MAXBUF];
-    int offset = strlen(tag);
-	for (int m=0;m<offset;m++) s[m] = line_buf[m];
-	s[offset] = '\0';
-	if (strcmp(s,tag)==0) {
-		int m = 0;
-		while (text_char(line_buf[m+offset])) {
-			dest[m] = line_buf[m+offset];
-			m++;
-		}
-		dest[m] = '\0';
-        return true;
-	}
-    return false;
+// set a menu_tracklog_ value from the tracklog's header, if it has that value
+void menu_tracklog_value(char *dest, char *value) {
+	if (value[0]!='\0') strcpy_s(dest, MAXBUF, value);
 }
+
 // display a menu of information about a tracklog
 void menu_tracklog(char *filename) {
 	char menu_text[12 * MAXBUF]; // buffer to hold menu display text
@@ -3133,18 +4846,20 @@ void menu_tracklog(char *filename) {
 		return;
 	}
 	// file exists
-	FILE *f;
-	errno_t err;
+	IgcReader r;
+	IgcHeader header;
 	char line_buf[MAXBUF];
 	int i = 0; // record counter
 	int j = 0; // general counter
 
     // try opening it for reading - return if this fails
-	if( (err = fopen_s(&f, filename, "r")) != 0 ) {
+	if (!igc_reader_open(&r, filename)) {
 		return;
 	}
 
-	while (fgets(line_buf, MAXBUF, f)!=NULL) {
+	// read the tracklog info, checking the G record checksum at the same time
+	igc_header_reset(&header);
+	while (igc_reader_line(&r, line_buf, MAXBUF)) {
         // test for B record first, it's the most common...
         if (line_buf[0]=='B') {
             if (strcmp(menu_tracklog_starttime,"0")==0) {
@@ -3172,38 +4887,24 @@ void menu_tracklog(char *filename) {
             continue;
         }
 
-		if (igc_read(line_buf, "HFDTE", menu_tracklog_date)) continue;
-		if (igc_read(line_buf, "HFGTYGLIDERTYPE:", menu_tracklog_aircraft)) continue ;
-		if (igc_read(line_buf, "HFCIDCOMPETITIONID:", menu_tracklog_id)) continue;
-        if (igc_read(line_buf, "HFPLTPILOTINCHARGE:", menu_tracklog_pilot)) continue;
-        if (igc_read(line_buf, "L FSX GENERAL CHECKSUM            ",
-            menu_tracklog_general_checksum)) continue;
-        if (igc_read(line_buf, "L FSX FLT checksum            ",
-            menu_tracklog_flt_checksum)) continue;
-        if (igc_read(line_buf, "L FSX WX checksum             ",
-            menu_tracklog_wx_checksum)) continue;
-        if (igc_read(line_buf, "L FSX CMX checksum            ",
-            menu_tracklog_cmx_checksum)) continue;
-        if (igc_read(line_buf, "L FSX CumulusX.exe checksum   ",
-            menu_tracklog_cx_checksum)) continue;
-        if (igc_read(line_buf, "L FSX mission checksum        ",
-            menu_tracklog_mission_checksum)) continue;
-        if (igc_read(line_buf, "L FSX aircraft.cfg checksum   ",
-            menu_tracklog_cfg_checksum)) continue;
-        if (igc_read(line_buf, "L FSX AIR checksum            ",
-            menu_tracklog_air_checksum)) continue;
-        if (igc_read(line_buf, "L FSX CumulusX status:        ",
-            menu_tracklog_cx_status)) continue;
-        if (igc_read(line_buf, "L FSX WX status:              ",
-            menu_tracklog_wx_status)) continue;
-        // small bugfix to accept '=' versions prior to 2.0
-        if (igc_read(line_buf, "L FSX WX status=              ",
-            menu_tracklog_wx_status)) continue;
-        if (igc_read(line_buf, "L FSX ThermalDescriptions.xml ",
-            menu_tracklog_thermals_status)) continue;
-
+		igc_header_line(&header, line_buf);
     }
-	fclose(f);
+	menu_tracklog_g_status = igc_reader_close(&r);
+	menu_tracklog_value(menu_tracklog_date, header.date);
+	menu_tracklog_value(menu_tracklog_aircraft, header.glider_type);
+	menu_tracklog_value(menu_tracklog_id, header.competition_id);
+	menu_tracklog_value(menu_tracklog_pilot, header.pilot);
+	menu_tracklog_value(menu_tracklog_general_checksum, header.general_checksum);
+	menu_tracklog_value(menu_tracklog_flt_checksum, header.flt_checksum);
+	menu_tracklog_value(menu_tracklog_wx_checksum, header.wx_checksum);
+	menu_tracklog_value(menu_tracklog_cmx_checksum, header.cmx_checksum);
+	menu_tracklog_value(menu_tracklog_cx_checksum, header.cx_checksum);
+	menu_tracklog_value(menu_tracklog_mission_checksum, header.mission_checksum);
+	menu_tracklog_value(menu_tracklog_cfg_checksum, header.cfg_checksum);
+	menu_tracklog_value(menu_tracklog_air_checksum, header.air_checksum);
+	menu_tracklog_value(menu_tracklog_cx_status, header.cx_status);
+	menu_tracklog_value(menu_tracklog_wx_status, header.wx_status);
+	menu_tracklog_value(menu_tracklog_thermals_status, header.thermals_status);
 
 	// now build the menu_text string, which has title/prompt/item1, etc with NULLS between
 	pc = menu_text;
@@ -3243,7 +4944,6 @@ void menu_tracklog(char *filename) {
 	pc += strlen(s)+1;
 
     // Item #3: validity of IGC file via G checksum
-    menu_tracklog_g_status = check_file(filename);
     switch (menu_tracklog_g_status) {
         case CHKSUM_OK:
             strcpy_s(s, MAXBUF,lang_checksum_ok);
@@ -3916,6 +5616,7 @@ void CALLBACK MyDispatchProcSO(SIMCONNECT_RECV* pData, DWORD cbData, void *pCont
 				case EVENT_WEATHER: // User has changed weather
 					if (debug) printf(" [EVENT_WEATHER]\n");
 					wx_code = 0;
+					chksum_files_wait(); // WX checksum may still be running
                     strcpy_s(chksum_wx, CHKSUM_CHARS+1, "000000");
                     strcpy_s(wx_name, MAXBUF, "free flight");
 					break;
@@ -4372,6 +6073,8 @@ void connectToSim()
         while( hr == S_OK && 0 == quit )
         {
             hr = SimConnect_CallDispatch(hSimConnect, MyDispatchProcSO, NULL);
+            ai_control_flush();
+            replay_load_poll();
             Sleep(1);
         } 
 		if (hr==S_OK) hr = SimConnect_Close(hSimConnect);
@@ -4387,10 +6090,1066 @@ void connectToSim()
 }
 
 
+//*********************************************************************************************
+//*********************************************************************************************
+// ************************************   BENCHMARKS   ****************************************
+//*********************************************************************************************
+//*********************************************************************************************
+// 'sim_logger bench [file ...]' times the checksum code on the given files (or on a
+// generated buffer if no files are given) and prints the results to the console.
+// 'sim_logger bench io file ...' times reading the files (see bench_io_file()).
+// 'sim_logger bench igc [file ...]' times decoding B records (see bench_igc()).
+// 'sim_logger bench ai' times the AI steering sums and point search (see bench_ai()).
+// 'sim_logger bench geo' checks and times the geodesy kernels (see bench_geo()).
+
+const size_t BENCH_DEFAULT_BYTES = 16*1024*1024; // size of generated buffer if no files given
+
+// the original linear-search version of incr_chksum(), kept as the benchmark reference
+void incr_chksum_scan(ChksumData *chk_data, char c) {
+	unsigned int c_pos = 0;
+	while (c_pos<CHK_CHARS && chk_source[c_pos]!=c) c_pos++;
+	if (c_pos==CHK_CHARS) return;
+	int map_num = chk_map[(c_pos + chk_data->index) % CHK_CHARS];
+	for (int i=0; i<CHKSUM_CHARS; i++) {
+		chk_data->num[i] = chk_map[(chk_data->num[i]+map_num+i) % CHK_CHARS];
+	}
+	chk_data->index = (chk_data->index + 1) % CHKSUM_MAX_INDEX;
+}
+
+// read a whole file into a malloc'd buffer (NULL on error)
+char *bench_load_file(char *filepath, size_t *size) {
+	FILE *f;
+	if (fopen_s(&f, filepath, "rb") != 0) return NULL;
+	fseek(f, 0, SEEK_END);
+	long length = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	char *buf = (char *)malloc(length>0 ? length : 1);
+	if (buf!=NULL) *size = fread(buf, 1, length, f);
+	fclose(f);
+	return buf;
+}
+
+// fill a buffer with pseudo-random IGC-like text (so the valid/ignored char mix is realistic)
+char *bench_make_buffer(size_t size) {
+	const char text[] = "B1101355206343N00006198WA0058700558000\nLFSX 0123456789 .,:;-_()\n";
+	char *buf = (char *)malloc(size);
+	unsigned int seed = 12345;
+	if (buf==NULL) return NULL;
+	for (size_t i=0; i<size; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = text[(seed >> 16) % (sizeof(text)-1)];
+	}
+	return buf;
+}
+
+// chksum_table_build()+chksum_table_apply() and chksum_parallel() as engines for
+// bench_chksum_engine() (they must give the same checksum as chksum_block())
+void bench_table_engine(ChksumData *chk_data, const char *buf, size_t count) {
+	ChksumTable table;
+	chksum_table_build(&table, buf, count, chk_data->index);
+	chksum_table_apply(chk_data, &table);
+}
+
+int bench_threads = 2; // threads for bench_parallel_engine()
+
+void bench_parallel_engine(ChksumData *chk_data, const char *buf, size_t count) {
+	chksum_parallel(chk_data, buf, count, bench_threads);
+}
+
+// time one checksum engine over buf, repeating until we have a measurable time
+double bench_chksum_engine(void (*engine)(ChksumData *, const char *, size_t),
+						   char *buf, size_t size, char chksum[CHKSUM_CHARS+1]) {
+	ChksumData chk_data;
+	int passes = 0;
+	double t = perf_seconds();
+	do {
+		chksum_reset(&chk_data);
+		engine(&chk_data, buf, size);
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	chksum_to_string(chksum, chk_data);
+	return (perf_seconds() - t) / passes;
+}
+
+void bench_chksum_buffer(char *name, char *buf, size_t size) {
+	ChksumData chk_scan;
+	char chksum_scan[CHKSUM_CHARS+1] = "000000";
+	char chksum_scalar[CHKSUM_CHARS+1] = "000000";
+	char chksum_simd[CHKSUM_CHARS+1] = "000000";
+	char chksum_table[CHKSUM_CHARS+1] = "000000";
+	char chksum_par[CHKSUM_CHARS+1] = "000000";
+	double mb = (double)size / (1024*1024);
+
+	// reference: original per-char linear search
+	chksum_reset(&chk_scan);
+	double t = perf_seconds();
+	for (size_t i=0; i<size; i++) incr_chksum_scan(&chk_scan, buf[i]);
+	double t_scan = perf_seconds() - t;
+	chksum_to_string(chksum_scan, chk_scan);
+
+	printf("%s (%.1f MB)\n", name, mb);
+	printf("    incr_chksum (linear scan): %8.1f MB/s  %s\n", mb / t_scan, chksum_scan);
+
+	double t_scalar = bench_chksum_engine(chksum_block_scalar, buf, size, chksum_scalar);
+	printf("    chksum_block (scalar):     %8.1f MB/s  %s  x%.1f\n",
+		mb / t_scalar, chksum_scalar, t_scan / t_scalar);
+	if (strcmp(chksum_scan, chksum_scalar)!=0) printf("    ERROR: scalar checksum differs\n");
+
+	if (chksum_ssse3) {
+		double t_simd = bench_chksum_engine(chksum_block_ssse3, buf, size, chksum_simd);
+		printf("    chksum_block (SSSE3):      %8.1f MB/s  %s  x%.1f\n",
+			mb / t_simd, chksum_simd, t_scan / t_simd);
+		if (strcmp(chksum_scan, chksum_simd)!=0) printf("    ERROR: SSSE3 checksum differs\n");
+
+		// the table build speed is what chksum_table_cost should reflect
+		double t_table = bench_chksum_engine(bench_table_engine, buf, size, chksum_table);
+		printf("    chksum_table_build (%s): %6.1f MB/s  %s  (cost x%.1f, chksum_table_cost=%d)\n",
+			chksum_vbmi ? "VBMI " : "SSSE3", mb / t_table, chksum_table, t_table / t_simd, chksum_table_cost);
+		if (strcmp(chksum_scan, chksum_table)!=0) printf("    ERROR: table checksum differs\n");
+
+		bench_threads = max(chksum_cpus, 2);
+		double t_par = bench_chksum_engine(bench_parallel_engine, buf, size, chksum_par);
+		printf("    chksum_parallel (%2d CPUs): %8.1f MB/s  %s  x%.1f\n",
+			bench_threads, mb / t_par, chksum_par, t_scan / t_par);
+		if (strcmp(chksum_scan, chksum_par)!=0) printf("    ERROR: parallel checksum differs\n");
+	}
+
+	// the content hash, for comparison ('verify fast')
+	int passes = 0;
+	UINT64 hash = 0;
+	t = perf_seconds();
+	do {
+		hash ^= xxh64(buf, size);
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_hash = (perf_seconds() - t) / passes;
+	printf("    xxh64 (content hash):      %8.1f MB/s  x%.1f\n", mb / t_hash, t_scan / t_hash);
+}
+
+// differential test of the SSSE3 engine, and of a buffer split in two and joined
+// with a ChksumTable, against the scalar engine on random data, random
+// lengths/alignments and random starting states. Returns number of failures.
+int bench_chksum_diff() {
+	const int TESTS = 2000;
+	const size_t MAX_LENGTH = 10000;
+	char *buf = (char *)malloc(MAX_LENGTH+16);
+	unsigned int seed = 4321;
+	int failures = 0;
+	int table_failures = 0;
+
+	if (buf==NULL) return 1;
+	for (int test=0; test<TESTS; test++) {
+		ChksumData chk_scalar, chk_simd, chk_split;
+		ChksumTable table;
+		seed = seed * 1103515245 + 12345;
+		size_t length = (seed >> 8) % MAX_LENGTH;
+		size_t offset = seed % 16;
+		for (size_t i=0; i<length; i++) {
+			seed = seed * 1103515245 + 12345;
+			// alternate all-bytes and mostly-valid text
+			buf[offset+i] = (test & 1) ? (char)(seed >> 16) : chk_source[(seed >> 16) % (CHK_CHARS+8)];
+		}
+		chksum_reset(&chk_scalar);
+		chk_scalar.index = (int)(seed % CHKSUM_MAX_INDEX);
+		for (int i=0; i<CHKSUM_CHARS; i++) chk_scalar.num[i] = (int)((seed >> (i+3)) % CHK_CHARS);
+		chk_simd = chk_scalar;
+		chk_split = chk_scalar;
+		size_t split = (length>0) ? (seed >> 4) % length : 0;
+		chksum_block_scalar(&chk_scalar, buf+offset, length);
+		chksum_block_ssse3(&chk_simd, buf+offset, length);
+		chksum_block_scalar(&chk_split, buf+offset, split);
+		chksum_table_build(&table, buf+offset+split, length-split, chk_split.index);
+		chksum_table_apply(&chk_split, &table);
+		if (memcmp(&chk_scalar, &chk_simd, sizeof(ChksumData))!=0) failures++;
+		if (memcmp(&chk_scalar, &chk_split, sizeof(ChksumData))!=0) table_failures++;
+	}
+	free(buf);
+	printf("SSSE3 vs scalar checksum on %d random buffers: %d failures\n", TESTS, failures);
+	printf("table vs scalar checksum on %d random buffers: %d failures\n", TESTS, table_failures);
+	return failures + table_failures;
+}
+
+// 'sim_logger bench igc [file ...]' times decoding the B records of the files (or
+// BENCH_B_RECORDS generated ones) with igc_decode_b() and with the copy + sscanf_s()
+// decoder it replaced, and checks they agree (to the float precision of the old one).
+// With SSSE3 it also times igc_decode_b_batch_ssse3() and checks it gives exactly
+// what igc_decode_b() does, on the records and on damaged copies of them.
+
+const int BENCH_B_RECORDS = 1000000;
+const int BENCH_B_WIDTH = 100; // chars kept of each B record
+volatile INT32 bench_igc_sum; // so the decoding isn't optimised away
+
+// the original B record decoder from load_igc_file(), kept as the benchmark reference
+bool bench_decode_b_sscanf(char *line_buf, IgcFix *fix) {
+	char s[MAXBUF];
+	int j;
+	j = 0;
+	s[j++] = line_buf[1]; // HH
+	s[j++] = line_buf[2];
+	s[j++] = ' ';
+	s[j++] = line_buf[3]; // MM
+	s[j++] = line_buf[4];
+	s[j++] = ' ';
+	s[j++] = line_buf[5]; // SS
+	s[j++] = line_buf[6];
+	s[j++] = ' ';
+	s[j++] = line_buf[7]; // DD latitude
+	s[j++] = line_buf[8];
+	s[j++] = ' ';
+	s[j++] = line_buf[9]; // MM
+	s[j++] = line_buf[10];
+	s[j++] = '.';
+	s[j++] = line_buf[11]; // mmm
+	s[j++] = line_buf[12];
+	s[j++] = line_buf[13];
+	s[j++] = ' ';
+	s[j++] = line_buf[14]; // N/S (N positive)
+	//s[j++] = ' ';
+	s[j++] = line_buf[15]; // DDD longitude
+	s[j++] = line_buf[16];
+	s[j++] = line_buf[17];
+	s[j++] = ' ';
+	s[j++] = line_buf[18]; // MM
+	s[j++] = line_buf[19];
+	s[j++] = '.';
+	s[j++] = line_buf[20]; // mmm
+	s[j++] = line_buf[21];
+	s[j++] = line_buf[22];
+	s[j++] = ' ';
+	s[j++] = line_buf[23]; // E/W (E positive)
+	//s[j++] = ' ';
+	s[j++] = line_buf[25]; // alt
+	s[j++] = line_buf[26];
+	s[j++] = line_buf[27];
+	s[j++] = line_buf[28]; 
+	s[j++] = line_buf[29];
+	s[j++] = '\0';
+	// if (debug) printf("Parsed to: %s\n",s);
+	// now parse s into floats using sscanf
+	int hours,mins,secs, d_lat, d_long, alt;
+	float m_lat,m_long;
+	char ns, ew; // north/south, east/west
+	if (sscanf_s(s, "%d %d %d %d %f %c %d %f %c %d",
+				&hours,&mins,&secs,&d_lat, &m_lat, &ns, 1, &d_long, &m_long, &ew, 1, &alt) != 10) return false;
+	fix->latitude = (d_lat + m_lat/60);
+	if (ns=='S') fix->latitude = -fix->latitude;
+	fix->longitude = (d_long + m_long/60);
+	if (ew=='W') fix->longitude = -fix->longitude;
+	fix->altitude = alt;
+	fix->zulu_time = 3600*hours+60*mins+secs;
+	return true;
+}
+
+// B records from filepath, or generated ones if filepath is NULL
+char (*bench_b_records(char *filepath, int *count))[BENCH_B_WIDTH] {
+	char (*records)[BENCH_B_WIDTH] = (char (*)[BENCH_B_WIDTH])malloc(BENCH_B_RECORDS*BENCH_B_WIDTH);
+	unsigned int seed = 999;
+	*count = 0;
+	if (records==NULL) return NULL;
+	if (filepath==NULL) {
+		for (int i=0; i<BENCH_B_RECORDS; i++) {
+			seed = seed * 1103515245 + 12345;
+			sprintf_s(records[i], BENCH_B_WIDTH, "B%02d%02d%02d%02d%05d%c%03d%05d%cA%05d%05d\n",
+				(seed>>8)%24, (seed>>4)%60, seed%60, (seed>>12)%90, (seed>>3)%60000, (seed & 8) ? 'N' : 'S',
+				(seed>>10)%180, (seed>>5)%60000, (seed & 16) ? 'E' : 'W', (seed>>7)%10000, (seed>>9)%10000);
+		}
+		*count = BENCH_B_RECORDS;
+		return records;
+	}
+	FileReader r;
+	if (!file_open(&r, filepath)) {
+		free(records);
+		return NULL;
+	}
+	while (*count<BENCH_B_RECORDS && file_read_line(&r, records[*count], BENCH_B_WIDTH))
+		if (records[*count][0]=='B') (*count)++;
+	file_close(&r);
+	return records;
+}
+
+// true if the SSSE3 and scalar batch decoders agree on the count records at recs
+bool bench_igc_batch_same(const char **recs, const size_t *lengths, int count) {
+	IgcFix fixes[IGC_B_BATCH], ref[IGC_B_BATCH];
+	bool valid[IGC_B_BATCH], ref_valid[IGC_B_BATCH];
+	igc_decode_b_batch_ssse3(recs, lengths, count, fixes, valid);
+	igc_decode_b_batch_scalar(recs, lengths, count, ref, ref_valid);
+	for (int k=0; k<count; k++) {
+		if (valid[k]!=ref_valid[k]) return false;
+		if (valid[k] && (fixes[k].zulu_time!=ref[k].zulu_time || fixes[k].altitude!=ref[k].altitude ||
+			fixes[k].latitude!=ref[k].latitude || fixes[k].longitude!=ref[k].longitude)) return false;
+	}
+	return true;
+}
+
+// SSSE3 batch decoding of the records: checked against igc_decode_b() on the records
+// and on copies with random chars changed (or cut short), then timed
+void bench_igc_batch(char (*records)[BENCH_B_WIDTH], int count, double t_sscanf) {
+	const char **recs = (const char **)malloc(count*sizeof(char *));
+	size_t *lengths = (size_t *)malloc(count*sizeof(size_t));
+	const char mutations[] = "0123456789-+NSEWAVB :\r\n";
+	char mutant[BENCH_B_WIDTH];
+	const char *mutant_rec = mutant;
+	size_t mutant_length;
+	unsigned int seed = 999;
+	int differ = 0;
+	int mutant_differ = 0;
+	IgcFix fixes[IGC_B_BATCH];
+	bool valid[IGC_B_BATCH];
+	INT32 sum = 0;
+	int passes;
+	double t;
+
+	if (recs==NULL || lengths==NULL) {
+		free(recs);
+		free(lengths);
+		return;
+	}
+	for (int i=0; i<count; i++) {
+		recs[i] = records[i];
+		lengths[i] = strlen(records[i]);
+	}
+	for (int i=0; i<count; i+=IGC_B_BATCH)
+		if (!bench_igc_batch_same(recs+i, lengths+i, min(IGC_B_BATCH, count-i))) differ++;
+	for (int i=0; i<count; i++) {
+		memcpy(mutant, records[i], BENCH_B_WIDTH);
+		mutant_length = lengths[i];
+		for (int m=0; m<4; m++) {
+			seed = seed * 1103515245 + 12345;
+			int column = (seed>>8) % IGC_B_MIN_LENGTH;
+			switch ((seed>>4) % 4) {
+			case 0: // cut short
+				mutant_length = min(mutant_length, (size_t)column);
+				break;
+			default:
+				mutant[column] = mutations[(seed>>16) % (sizeof(mutations)-1)];
+			}
+			if (!bench_igc_batch_same(&mutant_rec, &mutant_length, 1)) mutant_differ++;
+		}
+	}
+	passes = 0;
+	t = perf_seconds();
+	do {
+		for (int i=0; i<count; i+=IGC_B_BATCH) {
+			int n = min(IGC_B_BATCH, count-i);
+			igc_decode_b_batch_ssse3(recs+i, lengths+i, n, fixes, valid);
+			for (int k=0; k<n; k++) sum += fixes[k].zulu_time;
+		}
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_batch = (perf_seconds() - t) / passes;
+	printf("    SSSE3 batch:       %8.2f M records/s  x%.1f\n", count / t_batch / 1e6, t_sscanf / t_batch);
+	printf("    %d batches and %d of %d changed records decoded differently by SSSE3\n",
+		   differ, mutant_differ, 4*count);
+	bench_igc_sum += sum;
+	free(recs);
+	free(lengths);
+}
+
+void bench_igc(char *name, char (*records)[BENCH_B_WIDTH], int count) {
+	IgcFix fix, ref;
+	INT32 sum = 0;
+	int passes;
+	int rejected = 0;
+	int differ = 0;
+	double t;
+
+	for (int i=0; i<count; i++) {
+		bool ok = igc_decode_b(records[i], strlen(records[i]), &fix);
+		if (!ok) rejected++;
+		if (ok && (!bench_decode_b_sscanf(records[i], &ref) || fix.zulu_time!=ref.zulu_time ||
+			fix.altitude!=ref.altitude || fabs(fix.latitude-ref.latitude)>1e-5 ||
+			fabs(fix.longitude-ref.longitude)>1e-5)) differ++;
+	}
+	printf("%s (%d B records)\n", name, count);
+	if (count==0) return;
+
+	passes = 0;
+	t = perf_seconds();
+	do {
+		for (int i=0; i<count; i++) {
+			bench_decode_b_sscanf(records[i], &ref);
+			sum += ref.zulu_time;
+		}
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_sscanf = (perf_seconds() - t) / passes;
+	printf("    copy + sscanf_s:   %8.2f M records/s\n", count / t_sscanf / 1e6);
+
+	passes = 0;
+	t = perf_seconds();
+	do {
+		for (int i=0; i<count; i++) {
+			igc_decode_b(records[i], strlen(records[i]), &fix);
+			sum += fix.zulu_time;
+		}
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_decode = (perf_seconds() - t) / passes;
+	printf("    igc_decode_b:      %8.2f M records/s  x%.1f\n", count / t_decode / 1e6, t_sscanf / t_decode);
+	printf("    %d rejected as invalid, %d decoded differently\n", rejected, differ);
+	if (chksum_ssse3) bench_igc_batch(records, count, t_sscanf);
+	else printf("    SSSE3 not available on this CPU\n");
+	bench_igc_sum += sum;
+}
+
+// 'sim_logger bench ai' times ai_steer(), the sums update_ai() does for each AI object
+// every second, on BENCH_AI generated tracklogs, against the same done with bearing()
+// and distance() on latitude/longitude as before (bench_ai_steer_spherical()), and
+// prints the biggest differences between them. Then it times the point search
+// update_ai() does each second (bench_ai_search()).
+
+const int BENCH_AI_POINTS = 3600; // 1 hour of 1 second points
+const int BENCH_AI_SEARCH_HOURS = 5; // length of the bench_ai_search() tracklog
+const int BENCH_AI_TICKS = 600;   // AI updates timed for each tracklog
+const double BENCH_AI_PREDICT = 4;
+volatile DWORD bench_ai_sum; // so the steering isn't optimised away
+
+// the original update_ai() steering sums, kept as the benchmark reference
+void bench_ai_steer_spherical(AiSteer *s, const ReplayTrack *r, int j, double predict_time,
+							  double period, double alt_offset, AIStruct *pos) {
+	ReplayPoint predict_point;
+	double progress = (predict_time - replay_time(r, j-1))/(replay_time(r, j) - replay_time(r, j-1));
+	progress = max(progress,0); // don't extrapolate *before* r[j-1]
+	predict_point.latitude = replay_latitude(r, j-1) + progress * (replay_latitude(r, j) - replay_latitude(r, j-1));
+	predict_point.longitude = replay_longitude(r, j-1) + progress * (replay_longitude(r, j) - replay_longitude(r, j-1));
+	predict_point.altitude = replay_altitude(r, j-1) + progress * (replay_altitude(r, j) - replay_altitude(r, j-1)) + alt_offset;
+	predict_point.heading = bearing(replay_latitude(r, j-1), replay_longitude(r, j-1),replay_latitude(r, j), replay_longitude(r, j));
+	if (pos->sim_on_ground) {
+		predict_point.pitch = 0;
+		predict_point.bank = 0;
+	} else {
+		predict_point.bank = replay_bank(r, j-1) + progress * (replay_bank(r, j) - replay_bank(r, j-1));
+		predict_point.pitch = replay_pitch(r, j-1) + progress * (replay_pitch(r, j) - replay_pitch(r, j-1));
+	}
+	s->predict_point = predict_point;
+	s->bearing_to_wp = bearing(pos->latitude, pos->longitude, predict_point.latitude, predict_point.longitude);
+	s->distance = distance(pos->latitude, pos->longitude, predict_point.latitude, predict_point.longitude);
+	s->heading_rate = slew_turn_rate(s->bearing_to_wp, pos->heading, predict_point.heading);
+	s->ahead_rate = slew_ahead_rate(pos->latitude, pos->longitude,
+									predict_point.latitude, predict_point.longitude, period);
+	s->bank_rate = slew_rotation_to_rate((predict_point.bank - pos->bank) / period);
+	s->pitch_rate = slew_rotation_to_rate((predict_point.pitch - pos->pitch) / period);
+	s->alt_rate = slew_alt_to_rate((pos->altitude - predict_point.altitude) / period);
+}
+
+// a generated tracklog of count points: a glider circling and gliding alternate
+// minutes at 25 m/s, from lat,lon
+void bench_ai_points(ReplayPoint *p, int count, double lat, double lon, double heading) {
+	p[0].zulu_time = 36000;
+	p[0].latitude = lat;
+	p[0].longitude = lon;
+	p[0].altitude = 1000;
+	p[0].ext = igc_ext_none;
+	for (int i=1; i<count; i++) {
+		bool circling = (i/60) % 2 == 1;
+		if (circling) heading = fmod(heading + 0.2, 2*M_PI);
+		p[i] = distance_and_bearing(p[i-1], 25, heading);
+		p[i].zulu_time = p[i-1].zulu_time + 1;
+		p[i].altitude = p[i-1].altitude + (circling ? 1.5 : -1);
+		p[i].ext = igc_ext_none;
+	}
+}
+
+// load a bench_ai_points() tracklog into replay[ai_index]
+bool bench_ai_track(int ai_index, double lat, double lon, int count = BENCH_AI_POINTS) {
+	ReplayPoint *p = replay_arena_top(&replay_arena);
+	if (p==NULL || !replay_arena_fit(&replay_arena, count*sizeof(ReplayPoint))) return false;
+	bench_ai_points(p, count, lat, lon, ai_index * 0.1);
+	ai_update_pbhs(p, count);
+	ai_info[ai_index].logpoint_count = count;
+	ai_info[ai_index].frame.point = -1;
+	return replay_pack(&replay_arena, &replay[ai_index], p, count, false);
+}
+
+// the original update_ai() search, kept as the benchmark reference
+int bench_ai_find_scan(const ReplayTrack *r, int count, double t, int from) {
+	int i = from;
+	while (i<count-2 && t>replay_time(r, i)) i++;
+	return i;
+}
+
+// time the two point searches of an update_ai() call (the current point and the
+// predict point), scanning from the start as before and with replay_find(), at
+// each hour along a BENCH_AI_SEARCH_HOURS tracklog, and a warp there (replay_find()
+// from point 0, so from the tracklog's index). Checks replay_find() against the scan
+// for every time on the way, and replay_seek() for every time too.
+void bench_ai_search() {
+	int count = BENCH_AI_SEARCH_HOURS*3600;
+	if (!bench_ai_track(0, 52, -1, count)) {
+		printf("replay arena full\n");
+		return;
+	}
+	const ReplayTrack *r = &replay[0];
+	int sum = 0;
+	int differ = 0;
+	int hint = 0;
+	for (double t=replay_time(r, 0)-10; t<replay_time(r, count-1)+10; t+=0.25) {
+		int i = replay_find(r, count, t, hint);
+		int j = replay_find(r, count, t + BENCH_AI_PREDICT, i);
+		int k = 0;
+		while (k<count && replay_time(r, k)<t) k++;
+		if (replay_seek(r, count, t)!=k) differ++;
+		if (i!=bench_ai_find_scan(r, count, t, 1) || j!=bench_ai_find_scan(r, count, t + BENCH_AI_PREDICT, 1) ||
+			i!=replay_find(r, count, t, 0) || i!=replay_find(r, count, t, count)) differ++;
+		hint = i;
+	}
+	printf("point search on a %d hour tracklog, %d searches differ from the scan\n", BENCH_AI_SEARCH_HOURS, differ);
+	printf("    index: %d entries, %d bytes (%.1f%% of the tracklog)\n", r->index_count, (int)(r->index_count*sizeof(INT32)),
+		   100.0 * r->index_count*sizeof(INT32) / replay_track_bytes(count, false, r->index_count));
+	printf("    hour        scan      cursor        warp (ns per AI update)\n");
+	for (int hour=0; hour<=BENCH_AI_SEARCH_HOURS; hour++) {
+		int start = min(hour*3600, count-BENCH_AI_TICKS-10);
+		double t_scan, t_cursor, t_warp;
+		int passes = 0;
+		double t = perf_seconds();
+		do {
+			for (int k=0; k<BENCH_AI_TICKS; k++) {
+				double clock = replay_time(r, start+k) + 0.5;
+				int i = bench_ai_find_scan(r, count, clock, 1);
+				sum += bench_ai_find_scan(r, count, clock + BENCH_AI_PREDICT, i);
+			}
+			passes++;
+		} while (perf_seconds() - t < 0.2);
+		t_scan = (perf_seconds() - t) / passes / BENCH_AI_TICKS;
+
+		passes = 0;
+		t = perf_seconds();
+		do {
+			int i = start;
+			for (int k=0; k<BENCH_AI_TICKS; k++) {
+				double clock = replay_time(r, start+k) + 0.5;
+				i = replay_find(r, count, clock, i);
+				sum += replay_find(r, count, clock + BENCH_AI_PREDICT, i);
+			}
+			passes++;
+		} while (perf_seconds() - t < 0.2);
+		t_cursor = (perf_seconds() - t) / passes / BENCH_AI_TICKS;
+
+		passes = 0;
+		t = perf_seconds();
+		do {
+			for (int k=0; k<BENCH_AI_TICKS; k++) {
+				double clock = replay_time(r, start+k) + 0.5;
+				int i = replay_find(r, count, clock, 0);
+				sum += replay_find(r, count, clock + BENCH_AI_PREDICT, i);
+			}
+			passes++;
+		} while (perf_seconds() - t < 0.2);
+		t_warp = (perf_seconds() - t) / passes / BENCH_AI_TICKS;
+		printf("    %4d  %10.1f  %10.1f  %10.1f\n", hour, t_scan * 1e9, t_cursor * 1e9, t_warp * 1e9);
+	}
+	bench_ai_sum += sum;
+	replay_arena_reset(&replay_arena);
+}
+
+void bench_ai() {
+	AIStruct *pos = (AIStruct *)malloc(MAX_AI*BENCH_AI_TICKS*sizeof(AIStruct));
+	AiSteer steer, ref;
+	DWORD sum = 0;
+	double max_bearing = 0;
+	double max_distance = 0;
+	int max_heading_rate = 0;
+	int max_ahead_rate = 0;
+	int passes;
+	double t;
+
+	if (pos==NULL) return;
+	for (int ai_index=0; ai_index<MAX_AI; ai_index++) {
+		if (!bench_ai_track(ai_index, 52 + (ai_index%20) * 0.5, -1 + (ai_index/20) * 0.5)) {
+			printf("replay arena full\n");
+			free(pos);
+			return;
+		}
+		// the AI object is off the tracklog a little: 40m, 0.1 rad, 10m
+		for (int i=0; i<BENCH_AI_TICKS; i++) {
+			ReplayPoint q = replay_point(&replay[ai_index], i);
+			AIStruct *a = &pos[ai_index*BENCH_AI_TICKS + i];
+			a->latitude = q.latitude + 40 / METRES_PER_DEGREE;
+			a->longitude = q.longitude;
+			a->altitude = q.altitude + 10;
+			a->pitch = q.pitch;
+			a->bank = q.bank;
+			a->heading = fmod(q.heading + 0.1, 2*M_PI);
+			a->altitude_agl = a->altitude;
+			a->sim_on_ground = 0;
+		}
+	}
+	printf("%d AI objects, %d updates each\n", MAX_AI, BENCH_AI_TICKS);
+
+	// tick i: the AI object is at pos[] i, predicting from point i+BENCH_AI_PREDICT
+	for (int ai_index=0; ai_index<MAX_AI; ai_index++) {
+		const ReplayTrack *r = &replay[ai_index];
+		for (int i=0; i<BENCH_AI_TICKS; i++) {
+			AIStruct *a = &pos[ai_index*BENCH_AI_TICKS + i];
+			double predict_time = replay_time(r, i) + 0.5 + BENCH_AI_PREDICT;
+			int j = i + (int)BENCH_AI_PREDICT + 1;
+			ai_steer(&steer, r, &ai_info[ai_index].frame, j, predict_time, BENCH_AI_PREDICT, 0, a);
+			bench_ai_steer_spherical(&ref, r, j, predict_time, BENCH_AI_PREDICT, 0, a);
+			max_bearing = max(max_bearing, fabs(heading_delta(steer.bearing_to_wp, ref.bearing_to_wp)));
+			max_distance = max(max_distance, fabs(steer.distance - ref.distance));
+			max_heading_rate = max(max_heading_rate, abs((int)steer.heading_rate - (int)ref.heading_rate));
+			max_ahead_rate = max(max_ahead_rate, abs((int)steer.ahead_rate - (int)ref.ahead_rate));
+		}
+	}
+
+	passes = 0;
+	t = perf_seconds();
+	do {
+		for (int ai_index=0; ai_index<MAX_AI; ai_index++) {
+			const ReplayTrack *r = &replay[ai_index];
+			for (int i=0; i<BENCH_AI_TICKS; i++) {
+				double predict_time = replay_time(r, i) + 0.5 + BENCH_AI_PREDICT;
+				bench_ai_steer_spherical(&ref, r, i + (int)BENCH_AI_PREDICT + 1, predict_time,
+										 BENCH_AI_PREDICT, 0, &pos[ai_index*BENCH_AI_TICKS + i]);
+				sum += ref.heading_rate + ref.ahead_rate;
+			}
+		}
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_spherical = (perf_seconds() - t) / passes / (MAX_AI*BENCH_AI_TICKS);
+	printf("    bearing/distance:  %8.1f ns per AI update\n", t_spherical * 1e9);
+
+	passes = 0;
+	t = perf_seconds();
+	do {
+		for (int ai_index=0; ai_index<MAX_AI; ai_index++) {
+			const ReplayTrack *r = &replay[ai_index];
+			for (int i=0; i<BENCH_AI_TICKS; i++) {
+				double predict_time = replay_time(r, i) + 0.5 + BENCH_AI_PREDICT;
+				ai_steer(&steer, r, &ai_info[ai_index].frame, i + (int)BENCH_AI_PREDICT + 1, predict_time,
+						 BENCH_AI_PREDICT, 0, &pos[ai_index*BENCH_AI_TICKS + i]);
+				sum += steer.heading_rate + steer.ahead_rate;
+			}
+		}
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_steer = (perf_seconds() - t) / passes / (MAX_AI*BENCH_AI_TICKS);
+	printf("    ai_steer:          %8.1f ns per AI update  x%.1f\n", t_steer * 1e9, t_spherical / t_steer);
+	printf("    biggest differences: bearing to predict point %.4f degrees, distance %.3fm,\n"
+		   "    heading rate %d, ahead rate %d\n",
+		   rad2deg(max_bearing), max_distance, max_heading_rate, max_ahead_rate);
+	bench_ai_sum += sum;
+	replay_arena_reset(&replay_arena);
+	free(pos);
+}
+
+// 'sim_logger bench geo' checks geo_legs() against Vincenty's formulae on the WGS84
+// ellipsoid, on BENCH_GEO_LEGS random legs of 1m to 1000km, along with distance()
+// and bearing(), and the AVX2 kernel against the scalar one. Then it times them,
+// and ai_update_pbhs() on BENCH_AI tracklogs against the per-point bearing() and
+// distance() version it replaced (bench_ai_update_pbhs_spherical()).
+
+const int BENCH_GEO_LEGS = 100000;
+volatile double bench_geo_sum; // so the sums aren't optimised away
+
+// the original ai_update_pbhs(), for point i, kept as the benchmark reference
+void bench_ai_update_pbhs_spherical(ReplayPoint p[], int i) {
+	// pitch & speed
+	if (i==0) { p[i].pitch = 0; p[i].speed = 0; }
+	else {
+		double dist = distance(p[i-1].latitude,
+								      p[i-1].longitude,
+								      p[i].latitude,
+								      p[i].longitude);
+		p[i].pitch = desired_pitch(p[i].altitude-p[i-1].altitude,
+                                        dist,
+                                        p[i].zulu_time-p[i-1].zulu_time);
+		p[i].speed = dist / (p[i].zulu_time-p[i-1].zulu_time);
+		//if (debug) printf("%d %4.1f %3.2f\n", p[i].zulu_time, p[i].altitude, p[i].speed);
+	}
+
+    // heading
+    if (i==1) p[0].heading = bearing(p[0].latitude, p[0].longitude,
+                                     p[1].latitude, p[1].longitude);
+	else if (i>1) {
+		p[i-1].heading = target_heading(p[i-2].latitude, p[i-2].longitude,
+                                     p[i-1].latitude, p[i-1].longitude,
+                                     p[i].latitude, p[i].longitude);
+		//if (debug) printf("updating p[%2d-%d] (%2.5f,%2.5f) p[%2d-%d].heading=%.3f\n",
+		//	i, p[i].zulu_time,p[i].latitude, p[i].longitude,i-1,p[i-1].zulu_time,p[i-1].heading);
+	}
+
+	// bank
+	if (i<2) p[i].bank = 0;
+	else {
+		double this_bearing = bearing(p[i-1].latitude,
+								      p[i-1].longitude,
+								      p[i].latitude,
+								      p[i].longitude);
+		double prev_bearing = bearing(p[i-2].latitude,
+								      p[i-2].longitude,
+								      p[i-1].latitude,
+								      p[i-1].longitude);
+		double bearing_delta = fmod(this_bearing + 2*M_PI - prev_bearing, 2*M_PI);
+		if (bearing_delta>M_PI) bearing_delta = bearing_delta - 2*M_PI;
+		double turn_radians_per_second = bearing_delta / (p[i].zulu_time - p[i-1].zulu_time);
+		p[i].bank = -turn_radians_per_second * 4;
+        p[i].bank = min(p[i].bank, 1.5);
+        p[i].bank = max(p[i].bank, -1.5);
+	}
+
+}
+
+// and the heading fix-up load_igc_file() did after it
+void bench_ai_fixup_spherical(ReplayPoint p[], int count) {
+	bool valid_heading = false;
+	for (int x=count-2;x>=0;x--) {
+		const int MIN_HEADING_SPEED = 3;
+		if (distance(p[x].latitude,p[x].longitude,p[x+1].latitude,p[x+1].longitude)/(p[x+1].zulu_time-p[x].zulu_time) > MIN_HEADING_SPEED) {
+			valid_heading = true;
+			continue;
+		}
+		p[x].pitch = 0;
+		p[x].bank = 0;
+		if (valid_heading) p[x].heading = p[x+1].heading;
+	}
+}
+
+// Vincenty's inverse formula on the WGS84 ellipsoid: distance (m) and initial bearing
+// (radians, 0..2pi) from point 1 to point 2. false if it doesn't converge (which
+// is only for nearly antipodal points)
+bool bench_geo_vincenty(double lat1, double lon1, double lat2, double lon2, double *dist, double *bearing) {
+	const double a = 6378137.0;
+	const double f = 1/298.257223563;
+	const double b = a*(1-f);
+	double L = deg2rad(lon2 - lon1);
+	double U1 = atan((1-f) * tan(deg2rad(lat1)));
+	double U2 = atan((1-f) * tan(deg2rad(lat2)));
+	double sin_U1 = sin(U1), cos_U1 = cos(U1);
+	double sin_U2 = sin(U2), cos_U2 = cos(U2);
+	double lambda = L, lambda_prev;
+	double sin_lambda, cos_lambda, sin_sigma, cos_sigma, sigma, cos2_alpha, cos_2sm;
+	int iterations = 0;
+	do {
+		sin_lambda = sin(lambda);
+		cos_lambda = cos(lambda);
+		double n = cos_U1*sin_U2 - sin_U1*cos_U2*cos_lambda;
+		sin_sigma = sqrt(cos_U2*sin_lambda*cos_U2*sin_lambda + n*n);
+		if (sin_sigma==0) {
+			*dist = 0;
+			*bearing = 0;
+			return true;
+		}
+		cos_sigma = sin_U1*sin_U2 + cos_U1*cos_U2*cos_lambda;
+		sigma = atan2(sin_sigma, cos_sigma);
+		double sin_alpha = cos_U1*cos_U2*sin_lambda / sin_sigma;
+		cos2_alpha = 1 - sin_alpha*sin_alpha;
+		cos_2sm = (cos2_alpha!=0) ? cos_sigma - 2*sin_U1*sin_U2/cos2_alpha : 0;
+		double C = f/16*cos2_alpha*(4 + f*(4 - 3*cos2_alpha));
+		lambda_prev = lambda;
+		lambda = L + (1-C)*f*sin_alpha*(sigma + C*sin_sigma*(cos_2sm + C*cos_sigma*(-1 + 2*cos_2sm*cos_2sm)));
+	} while (fabs(lambda - lambda_prev)>1e-12 && ++iterations<200);
+	if (iterations>=200) return false;
+	double u2 = cos2_alpha * (a*a - b*b) / (b*b);
+	double A = 1 + u2/16384*(4096 + u2*(-768 + u2*(320 - 175*u2)));
+	double B = u2/1024*(256 + u2*(-128 + u2*(74 - 47*u2)));
+	double delta_sigma = B*sin_sigma*(cos_2sm + B/4*(cos_sigma*(-1 + 2*cos_2sm*cos_2sm) -
+						 B/6*cos_2sm*(-3 + 4*sin_sigma*sin_sigma)*(-3 + 4*cos_2sm*cos_2sm)));
+	*dist = b*A*(sigma - delta_sigma);
+	double az = atan2(cos_U2*sin_lambda, cos_U1*sin_U2 - sin_U1*cos_U2*cos_lambda);
+	*bearing = (az<0) ? az + 2*M_PI : az;
+	return true;
+}
+
+// time engine on the legs between the count points, ns per leg
+double bench_geo_engine(void (*engine)(const double *, const double *, int, double *, double *),
+						const double *lat, const double *lon, int count, double *dist, double *bearing) {
+	int passes = 0;
+	double t = perf_seconds();
+	do {
+		engine(lat, lon, count, dist, bearing);
+		bench_geo_sum += dist[count/2];
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	return (perf_seconds() - t) / passes / (count-1) * 1e9;
+}
+
+// distance() and bearing() as a geo_legs() engine
+void bench_geo_spherical(const double *lat, const double *lon, int count, double *dist, double *bearing) {
+	for (int k=0; k+1<count; k++) {
+		dist[k] = distance(lat[k], lon[k], lat[k+1], lon[k+1]);
+		bearing[k] = ::bearing(lat[k], lon[k], lat[k+1], lon[k+1]);
+	}
+}
+
+void bench_geo() {
+	int count = 2*BENCH_GEO_LEGS; // leg k is points 2k -> 2k+1
+	double *lat = (double *)malloc(count*sizeof(double));
+	double *lon = (double *)malloc(count*sizeof(double));
+	double *dist = (double *)malloc(count*sizeof(double));
+	double *bearing = (double *)malloc(count*sizeof(double));
+	double *dist2 = (double *)malloc(count*sizeof(double));
+	double *bearing2 = (double *)malloc(count*sizeof(double));
+	ReplayPoint *p = (ReplayPoint *)malloc(2*BENCH_AI_POINTS*sizeof(ReplayPoint));
+	ReplayPoint *q = p + BENCH_AI_POINTS;
+	unsigned int seed = 4321;
+	int passes;
+	double t;
+
+	if (lat==NULL || lon==NULL || dist==NULL || bearing==NULL || dist2==NULL || bearing2==NULL || p==NULL) {
+		printf("out of memory\n");
+		return;
+	}
+	for (int k=0; k<BENCH_GEO_LEGS; k++) {
+		ReplayPoint a, b;
+		seed = seed * 1103515245 + 12345;
+		a.latitude = (seed>>8) % 160000 / 1000.0 - 80;
+		seed = seed * 1103515245 + 12345;
+		a.longitude = (seed>>8) % 360000 / 1000.0 - 180;
+		seed = seed * 1103515245 + 12345;
+		double length = pow(10.0, (seed>>8) % 60000 / 10000.0); // 1m to 1000km
+		seed = seed * 1103515245 + 12345;
+		b = distance_and_bearing(a, length, (seed>>8) % 36000 * (M_PI / 18000));
+		lat[2*k] = a.latitude;
+		lon[2*k] = a.longitude;
+		lat[2*k+1] = b.latitude;
+		lon[2*k+1] = b.longitude;
+	}
+
+	// accuracy
+	double max_dist = 0, max_bearing = 0;            // geo_legs() vs Vincenty
+	double max_old_dist = 0, max_old_bearing = 0;    // distance()/bearing() vs Vincenty
+	double max_short = 0;                            // distance() vs geo_legs(), legs <100m
+	double max_avx2_dist = 0, max_avx2_bearing = 0;  // AVX2 vs scalar
+	geo_legs_scalar(lat, lon, count, dist, bearing);
+	bench_geo_spherical(lat, lon, count, dist2, bearing2);
+	for (int k=0; k<count; k+=2) {
+		double d, b;
+		if (!bench_geo_vincenty(lat[k], lon[k], lat[k+1], lon[k+1], &d, &b)) continue;
+		max_dist = max(max_dist, fabs(dist[k] - d) / d);
+		max_bearing = max(max_bearing, fabs(heading_delta(bearing[k], b)));
+		max_old_dist = max(max_old_dist, fabs(dist2[k] - d) / d);
+		max_old_bearing = max(max_old_bearing, fabs(heading_delta(bearing2[k], b)));
+		if (d<100) max_short = max(max_short, fabs(dist2[k] - dist[k]));
+	}
+	if (cpu_avx2) {
+		geo_legs_avx2(lat, lon, count, dist2, bearing2);
+		for (int k=0; k<count; k+=2) {
+			if (dist[k]>0) max_avx2_dist = max(max_avx2_dist, fabs(dist2[k] - dist[k]) / dist[k]);
+			max_avx2_bearing = max(max_avx2_bearing, fabs(heading_delta(bearing2[k], bearing[k])));
+		}
+	}
+	printf("%d legs of 1m to 1000km against Vincenty (WGS84), biggest differences:\n", BENCH_GEO_LEGS);
+	printf("    geo_legs:            distance %.3f%%, bearing %.3f degrees\n", max_dist * 100, rad2deg(max_bearing));
+	printf("    distance()/bearing(): distance %.3f%%, bearing %.3f degrees (distance() %.4fm out on legs <100m)\n",
+		   max_old_dist * 100, rad2deg(max_old_bearing), max_short);
+	if (cpu_avx2)
+		printf("    geo_legs_avx2 vs geo_legs_scalar: distance %.1e (relative), bearing %.1e radians\n",
+			   max_avx2_dist, max_avx2_bearing);
+
+	// legs
+	double t_spherical = bench_geo_engine(bench_geo_spherical, lat, lon, count, dist, bearing);
+	double t_scalar = bench_geo_engine(geo_legs_scalar, lat, lon, count, dist, bearing);
+	printf("    distance()+bearing(): %6.1f ns per leg\n", t_spherical);
+	printf("    geo_legs_scalar:      %6.1f ns per leg  x%.1f\n", t_scalar, t_spherical / t_scalar);
+	if (cpu_avx2) {
+		double t_avx2 = bench_geo_engine(geo_legs_avx2, lat, lon, count, dist, bearing);
+		printf("    geo_legs_avx2:        %6.1f ns per leg  x%.1f\n", t_avx2, t_spherical / t_avx2);
+	} else printf("    AVX2 not available on this CPU\n");
+
+	// ai_update_pbhs()
+	double max_pitch = 0, max_bank = 0, max_heading = 0;
+	for (int track=0; track<MAX_AI; track++) {
+		bench_ai_points(p, BENCH_AI_POINTS, 52 + (track%20) * 0.5, -1 + (track/20) * 0.5, track * 0.1);
+		memcpy(q, p, BENCH_AI_POINTS*sizeof(ReplayPoint));
+		for (int i=0; i<BENCH_AI_POINTS; i++) bench_ai_update_pbhs_spherical(p, i);
+		bench_ai_fixup_spherical(p, BENCH_AI_POINTS);
+		ai_update_pbhs(q, BENCH_AI_POINTS);
+		// (the last point's heading wasn't set before)
+		for (int i=0; i<BENCH_AI_POINTS-1; i++) {
+			max_pitch = max(max_pitch, fabs(q[i].pitch - p[i].pitch));
+			max_bank = max(max_bank, fabs(q[i].bank - p[i].bank));
+			max_heading = max(max_heading, fabs(heading_delta(q[i].heading, p[i].heading)));
+		}
+	}
+	passes = 0;
+	t = perf_seconds();
+	do {
+		for (int i=0; i<BENCH_AI_POINTS; i++) bench_ai_update_pbhs_spherical(p, i);
+		bench_ai_fixup_spherical(p, BENCH_AI_POINTS);
+		bench_geo_sum += p[BENCH_AI_POINTS/2].heading;
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_pbhs_spherical = (perf_seconds() - t) / passes / BENCH_AI_POINTS;
+	passes = 0;
+	t = perf_seconds();
+	do {
+		ai_update_pbhs(q, BENCH_AI_POINTS);
+		bench_geo_sum += q[BENCH_AI_POINTS/2].heading;
+		passes++;
+	} while (perf_seconds() - t < 0.5);
+	double t_pbhs = (perf_seconds() - t) / passes / BENCH_AI_POINTS;
+	printf("ai_update_pbhs on %d tracklogs of %d points:\n", MAX_AI, BENCH_AI_POINTS);
+	printf("    per point (bearing()/distance()): %6.1f ns per point\n", t_pbhs_spherical * 1e9);
+	printf("    geo_legs in blocks of %d:        %6.1f ns per point  x%.1f\n",
+		   GEO_BLOCK, t_pbhs * 1e9, t_pbhs_spherical / t_pbhs);
+	printf("    biggest differences: pitch %.4f, bank %.4f, heading %.4f degrees\n",
+		   rad2deg(max_pitch), rad2deg(max_bank), rad2deg(max_heading));
+
+	free(lat);
+	free(lon);
+	free(dist);
+	free(bearing);
+	free(dist2);
+	free(bearing2);
+	free(p);
+}
+
+// File reading benchmark: each file is read with fread() into a MAXBUF buffer (as
+// the checksum code used to), with a streamed FileReader and with a mapped
+// FileReader, each first from a cold and then from a warm file cache. 'calls' is the
+// number of fread()/ReadFile() calls (none when mapped), 'faults' the page faults
+// taken, which is where a mapped file does its reading. For the cold runs the file
+// is first opened unbuffered, which makes Windows purge it from the cache as long
+// as nothing else has it open (so a file open in FSX will still be warm).
+
+const int BENCH_IO_METHODS = 3;
+char *bench_io_names[BENCH_IO_METHODS] = { "fread (MAXBUF)", "FileReader (streamed)", "FileReader (mapped)" };
+volatile unsigned int bench_io_sum; // so the reads aren't optimised away
+
+DWORD bench_page_faults() {
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+	return pmc.PageFaultCount;
+}
+
+void bench_io_purge(char *filepath) {
+	HANDLE h = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+						   OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+	if (h!=INVALID_HANDLE_VALUE) CloseHandle(h);
+}
+
+// read filepath with bench_io_names[method], returns the bytes read (-1 on error)
+INT64 bench_io_read(int method, char *filepath, int *calls) {
+	INT64 total = 0;
+	unsigned int sum = 0; // one byte from each page, so a mapped file is really read
+	*calls = 0;
+	if (method==0) {
+		FILE *f;
+		char buf[MAXBUF];
+		size_t n;
+		if (fopen_s(&f, filepath, "rb")!=0) return -1;
+		do {
+			n = fread(buf, sizeof(char), sizeof(buf), f);
+			(*calls)++;
+			if (n>0) sum += buf[0];
+			total += n;
+		} while (n>0);
+		fclose(f);
+	}
+	else {
+		FileReader r;
+		const char *data;
+		size_t count;
+		if (!file_open(&r, filepath, method==2)) return -1;
+		while (file_read_block(&r, &data, &count)) {
+			for (size_t i=0; i<count; i+=4096) sum += data[i];
+			total += count;
+		}
+		*calls = r.reads;
+		file_close(&r);
+	}
+	bench_io_sum += sum;
+	return total;
+}
+
+void bench_io_file(char *filepath) {
+	printf("%s\n", filepath);
+	for (int method=0; method<BENCH_IO_METHODS; method++) {
+		for (int warm=0; warm<2; warm++) {
+			int calls;
+			if (!warm) bench_io_purge(filepath);
+			DWORD faults = bench_page_faults();
+			double t = perf_seconds();
+			INT64 size = bench_io_read(method, filepath, &calls);
+			t = perf_seconds() - t;
+			faults = bench_page_faults() - faults;
+			if (size<0) {
+				printf("    couldn't read file\n");
+				return;
+			}
+			printf("    %-22s %s: %8.1f MB/s %8d calls %8lu faults\n", bench_io_names[method],
+				warm ? "warm" : "cold", (double)size / (1024*1024) / t, calls, faults);
+		}
+	}
+}
+
+// xxh64() against the reference XXH64 values
+bool bench_xxh64_ok() {
+	return xxh64("", 0)==0xEF46DB3751D8E999ULL &&
+		   xxh64("abc", 3)==0x44BC2CF5AD770999ULL &&
+		   xxh64("Nobody inspects the spammish repetition", 39)==0xFBCEA83C8A378BF1ULL;
+}
+
+int bench_main(int argc, char* argv[]) {
+	if (argc>0 && strcmp(argv[0],"io")==0) {
+		printf("sim_logger v%.2f file reading benchmark\n", version);
+		for (int i=1; i<argc; i++) bench_io_file(argv[i]);
+		return 0;
+	}
+	if (argc>0 && strcmp(argv[0],"ai")==0) {
+		printf("sim_logger v%.2f AI steering benchmark\n", version);
+		bench_ai();
+		bench_ai_search();
+		return 0;
+	}
+	if (argc>0 && strcmp(argv[0],"geo")==0) {
+		printf("sim_logger v%.2f geodesy benchmark\n", version);
+		bench_geo();
+		return 0;
+	}
+	if (argc>0 && strcmp(argv[0],"igc")==0) {
+		printf("sim_logger v%.2f B record decoding benchmark\n", version);
+		for (int i=(argc>1) ? 1 : 0; i<argc; i++) {
+			int count;
+			char *filepath = (i==0) ? NULL : argv[i];
+			char (*records)[BENCH_B_WIDTH] = bench_b_records(filepath, &count);
+			if (records==NULL) {
+				printf("%s: couldn't read file\n", argv[i]);
+				continue;
+			}
+			bench_igc((filepath==NULL) ? "generated B records" : filepath, records, count);
+			free(records);
+		}
+		return 0;
+	}
+	printf("sim_logger v%.2f checksum benchmark\n", version);
+	printf("checksum tables %s\n", chksum_tables_ok() ? "OK" : "DO NOT MATCH chk_source/chk_map");
+	printf("xxh64 %s\n", bench_xxh64_ok() ? "OK" : "DOES NOT MATCH THE REFERENCE VALUES");
+	if (chksum_ssse3) bench_chksum_diff();
+	else printf("SSSE3 not available on this CPU\n");
+	if (argc==0) {
+		char *buf = bench_make_buffer(BENCH_DEFAULT_BYTES);
+		if (buf==NULL) return 1;
+		bench_chksum_buffer("generated IGC text", buf, BENCH_DEFAULT_BYTES);
+		free(buf);
+		return 0;
+	}
+	for (int i=0; i<argc; i++) {
+		size_t size = 0;
+		char *buf = bench_load_file(argv[i], &size);
+		if (buf==NULL) {
+			printf("%s: couldn't read file\n", argv[i]);
+			continue;
+		}
+		bench_chksum_buffer(argv[i], buf, size);
+		free(buf);
+	}
+	return 0;
+}
+
 //int __cdecl _tmain(int argc, _TCHAR* argv[])
 int main(int argc, char* argv[])
 {
 	igc_reset_log();
+	chksum_init();
+	chksum_cache_init();
+	replay_load_init();
+
+	// 'bench' mode just runs the benchmarks, it doesn't need FSX
+	if (argc>1 && strcmp(argv[1],"bench")==0) return bench_main(argc-2, argv+2);
+	// nor does 'verify' (checking a batch of IGC files)
+	if (argc>1 && strcmp(argv[1],"verify")==0) return verify_main(argc-2, argv+2);
 
 	// set up command line arguments (debug mode)
 	for (int i=1; i<argc; i++) {
@@ -4521,6 +7280,7 @@ int main(int argc, char* argv[])
 		if (debug_info) printf("+info");
 		if (debug_calls) printf("+calls");
 		if (debug_events) printf("+events");
+		printf("\nChecksum engine: %s\n", chksum_ssse3 ? "SSSE3" : "scalar");
 	} else if (debug_info) {
 		printf("Debug mode = debug_info\n");
 	}
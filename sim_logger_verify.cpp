@@ -0,0 +1,18 @@
+//------------------------------------------------------------------------------
+//						sim_logger
+//  sim_logger_verify - 'sim_logger verify' on its own
+//
+//  Description:
+//              checks batches of IGC files without FSX, e.g. on a Linux server
+//              (see README.md): sim_logger_verify [fast] [csv|json] path ...
+//
+//              Written by Ian Forster-Lewis www.forsterlewis.com
+//------------------------------------------------------------------------------
+
+#include "chksum.h"
+
+int main(int argc, char* argv[])
+{
+	chksum_init();
+	return verify_main(argc-1, argv+1);
+}